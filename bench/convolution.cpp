@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <print>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "audio_handler.h"
+#include "convolver.h"
+#include "fft.h"
+
+// Compares the uniformly partitioned convolver (the CabinetConvolver default)
+// with the non-uniform one, on the bundled cabinet IR and on a synthetic 3 s
+// room IR. For every block size it reports the average cost per sample and the
+// worst block time against the real time budget of one block.
+
+namespace fs = std::filesystem;
+
+constexpr float SAMPLE_RATE = 48000.0f;
+constexpr float SIGNAL_SECONDS = 10.0f;
+
+struct BenchResult {
+    double ns_per_sample;
+    double worst_block_us;
+};
+
+// First channel of the IR, empty if the file can't be opened
+static auto load_ir(const fs::path& path) -> std::vector<float> {
+    AudioFileHandler fh;
+    if (!fh.open_read(path.string())) return {};
+
+    int channels = fh.get_channels();
+    std::vector<float> interleaved(fh.get_total_frames() * channels);
+    sf_count_t frames =
+        fh.read_frames(interleaved.data(), fh.get_total_frames());
+
+    std::vector<float> ir(frames);
+    for (sf_count_t i = 0; i < frames; ++i) ir[i] = interleaved[i * channels];
+    return ir;
+}
+
+// Exponentially decaying noise, 60 dB down after `seconds`
+static auto make_room_ir(float seconds) -> std::vector<float> {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+
+    std::vector<float> ir(seconds * SAMPLE_RATE);
+    float decay = std::log(1000.0f) / ir.size();
+    for (size_t i = 0; i < ir.size(); ++i) {
+        ir[i] = noise(rng) * std::exp(-decay * i);
+    }
+    return ir;
+}
+
+static auto run(Convolver& convolver, const std::vector<float>& signal,
+                int block_size) -> BenchResult {
+    using clock = std::chrono::steady_clock;
+
+    std::vector<float> block(block_size);
+    double total_ns = 0, worst_ns = 0;
+
+    for (size_t start = 0; start + block_size <= signal.size();
+         start += block_size) {
+        std::copy_n(signal.begin() + start, block_size, block.begin());
+
+        auto begin = clock::now();
+        convolver.process(block, block);
+        double ns =
+            std::chrono::duration<double, std::nano>(clock::now() - begin)
+                .count();
+
+        total_ns += ns;
+        worst_ns = std::max(worst_ns, ns);
+    }
+
+    return {total_ns / signal.size(), worst_ns / 1000.0};
+}
+
+static auto bench_ir(const std::string& name, const std::vector<float>& ir,
+                     const std::vector<float>& signal) -> void {
+    std::print("\n{} ({} samples, {:.2f} s)\n", name, ir.size(),
+               ir.size() / SAMPLE_RATE);
+    std::print("{:>6} {:>12} {:>14} {:>14} {:>14} {:>14}\n", "block",
+               "budget [us]", "uni [ns/smp]", "uni worst[us]", "nu [ns/smp]",
+               "nu worst[us]");
+
+    for (int block_size : {64, 128, 256}) {
+        PartitionedConvolver uniform(
+            std::make_shared<IRPartitions>(ir, block_size));
+        NonUniformConvolver non_uniform(
+            std::make_shared<NonUniformIR>(ir, block_size));
+
+        BenchResult uni = run(uniform, signal, block_size);
+        BenchResult nu = run(non_uniform, signal, block_size);
+
+        std::print("{:>6} {:>12.1f} {:>14.2f} {:>14.1f} {:>14.2f} {:>14.1f}\n",
+                   block_size, block_size / SAMPLE_RATE * 1e6,
+                   uni.ns_per_sample, uni.worst_block_us, nu.ns_per_sample,
+                   nu.worst_block_us);
+    }
+}
+
+auto main(int argc, char** argv) -> int {
+    fs::path root_dir = fs::path(__FILE__).parent_path().parent_path();
+    fs::path ir_path =
+        argc > 1 ? fs::path(argv[1]) : root_dir / "samples" / "ir.wav";
+
+    fs::path wisdom_path = root_dir / "fftw.wisdom";
+    FFT::load_wisdom(wisdom_path.string());
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+    std::vector<float> signal(SIGNAL_SECONDS * SAMPLE_RATE);
+    for (auto& sample : signal) sample = noise(rng);
+
+    std::vector<float> cabinet_ir = load_ir(ir_path);
+    if (cabinet_ir.empty()) {
+        std::print("[WARN]: Failed to load {}, skipping it\n",
+                   ir_path.string());
+    } else {
+        bench_ir(ir_path.filename().string(), cabinet_ir, signal);
+    }
+
+    bench_ir("synthetic room", make_room_ir(3.0f), signal);
+
+    FFT::save_wisdom(wisdom_path.string());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,383 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <print>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "amp_filter.h"
+#include "audio_handler.h"
+#include "batch.h"
+#include "cabinet.h"
+#include "fft.h"
+#include "filter_chain.h"
+
+// FilterBench [--json results.json] [--samples dir]
+//   Measures ns/sample of every filter over block sizes, channel counts and
+//   parameter sets, and the realtime factor of DEFAULT_CHAIN on every file of
+//   the samples directory. Writes the results as JSON.
+//
+// FilterBench --compare base.json new.json [--threshold percent]
+//   Diffs two runs and flags the results that got slower by more than the
+//   threshold (10% by default). Exits with 1 if any did.
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr float SAMPLE_RATE = 48000.0f;
+constexpr float SIGNAL_SECONDS = 1.0f;
+constexpr int REPEATS = 3;
+constexpr size_t CHAIN_FRAMES = 4096;
+
+constexpr int BLOCK_SIZES[] = {64, 256, 1024, 4096, 8192};
+constexpr int CHANNEL_COUNTS[] = {1, 2};
+
+struct FilterConfig {
+    std::string name;
+    FilterParams params;
+
+    // Measured instead of CHANNEL_COUNTS when given (binaural_mixer renders
+    // one source per channel)
+    std::vector<int> channel_counts = {};
+};
+
+const std::vector<FilterConfig> FILTER_CONFIGS = {
+    {"bitcrusher", {}},
+    {"bitcrusher", {{"bits", 4}, {"downsample", 2}}},
+    {"crybaby", {}},
+    {"crybaby", {{"use_env_fol", 0}}},
+    {"overdrive", {{"table", 0}}},
+    {"overdrive", {{"table", 1}}},
+    {"overdrive", {{"table", 1}, {"oversample", 4}}},
+    {"pitchshifter", {{"pitch_factor", 1.5}}},
+    {"pitchshifter", {{"pitch_factor", 0.5}}},
+    {"pitchshifter", {{"pitch_factor", 1.5}, {"interpolation", 1}}},
+    {"pitchshifter", {{"pitch_factor", 1.5}, {"interpolation", 2}}},
+    {"pitchshifter", {{"pitch_factor", 1.5}, {"vocoder", 1}}},
+    {"pitchshifter", {{"pitch_factor", 0.5}, {"vocoder", 1}}},
+    {"harmonizer", {{"voices", 1}}},
+    {"harmonizer", {}},
+    {"cabinet", {}},
+    {"binaural_rotation", {}},
+    {"binaural_rotation", {{"apply_svf", 0}}},
+    {"binaural_mixer", {}, {2, 8}},
+    {"binaural_mixer", {{"apply_svf", 0}}, {2, 8}},
+};
+
+// One measurement. Results of two runs are matched by `id`.
+struct Result {
+    std::string id;
+
+    // "ns_per_sample" (lower is better) or "realtime_factor" (higher is)
+    std::string metric;
+    double value = 0;
+};
+
+auto describe(const FilterConfig& config) -> std::string {
+    std::string id = config.name;
+    for (const auto& [name, value] : config.params) {
+        id += std::format(" {}={}", name, value);
+    }
+    return id;
+}
+
+auto seconds_since(std::chrono::steady_clock::time_point begin) -> double {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         begin)
+        .count();
+}
+
+// Best of REPEATS passes over `signal`, after a warm up pass
+auto time_filter(AMPFilter& filter, const AudioBuffer& signal,
+                 int block_size) -> double {
+    int in_channels = filter.get_in_channels();
+    int out_channels = filter.get_out_channels();
+    size_t frames = signal.get_capacity();
+
+    // Whole blocks only, the time is per frame actually processed
+    size_t processed = frames / block_size * block_size;
+
+    AudioBuffer output(out_channels, block_size);
+    double best = 0;
+
+    for (int pass = 0; pass <= REPEATS; ++pass) {
+        auto begin = std::chrono::steady_clock::now();
+        for (size_t start = 0; start + block_size <= frames;
+             start += block_size) {
+            filter.process(signal.view().subview(start, block_size),
+                           output.view());
+        }
+        double seconds = seconds_since(begin);
+
+        if (pass > 0 && (best == 0 || seconds < best)) best = seconds;
+    }
+
+    // Per sample of one channel
+    return best * 1e9 / (double)(processed * in_channels);
+}
+
+auto bench_filters(const ChainResources& resources) -> std::vector<Result> {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+
+    std::vector<Result> results;
+    for (const auto& config : FILTER_CONFIGS) {
+        std::vector<int> channel_counts = config.channel_counts;
+        if (channel_counts.empty()) {
+            channel_counts.assign(std::begin(CHANNEL_COUNTS),
+                                  std::end(CHANNEL_COUNTS));
+        }
+
+        for (int channels : channel_counts) {
+            AudioBuffer signal(channels, SIGNAL_SECONDS * SAMPLE_RATE);
+            for (int c = 0; c < channels; ++c) {
+                std::generate_n(signal.channel(c), signal.get_capacity(),
+                                [&] { return noise(rng); });
+            }
+
+            for (int block_size : BLOCK_SIZES) {
+                std::unique_ptr<AMPFilter> filter;
+                try {
+                    filter = make_filter(config.name, channels, SAMPLE_RATE,
+                                         resources, config.params);
+                } catch (const std::exception&) {
+                    // e.g. no IR for the cabinet
+                    continue;
+                }
+                if (filter->get_in_channels() != channels) continue;
+
+                Result result{
+                    std::format("{} ch={} block={}", describe(config),
+                                channels, block_size),
+                    "ns_per_sample", time_filter(*filter, signal, block_size)};
+                std::print("{:<60} {:>10.2f} ns/sample\n", result.id,
+                           result.value);
+                results.push_back(result);
+            }
+        }
+    }
+    return results;
+}
+
+// Runs DEFAULT_CHAIN over a whole decoded file, without writing it.
+// The id of the result is completed by the caller.
+auto bench_file(const fs::path& path, const ChainResources& resources)
+    -> Result {
+    AudioFileHandler fh;
+    if (!fh.open_read(path.string())) {
+        throw std::runtime_error("Failed to open " + path.string());
+    }
+
+    int channels = fh.get_channels();
+    float sample_rate = fh.get_sample_rate();
+    AudioBuffer audio(channels, fh.get_total_frames());
+    size_t frames = fh.read_frames(audio.view());
+
+    auto chain = make_chain(parse_chain(DEFAULT_CHAIN), channels, sample_rate,
+                            resources);
+    std::vector<AMPFilter*> filters;
+    int flowing = channels;
+    for (const auto& filter : chain) {
+        if (filter->get_in_channels() != flowing) {
+            throw std::runtime_error(std::format(
+                "{} takes {} channels, gets {}", filter->get_filter_name(),
+                filter->get_in_channels(), flowing));
+        }
+        flowing = filter->get_out_channels();
+        filters.push_back(filter.get());
+    }
+
+    int max_channels = get_max_channels(filters, channels);
+    AudioBuffer buffer(max_channels, CHAIN_FRAMES);
+    AudioBuffer scratch(max_channels, CHAIN_FRAMES);
+
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t start = 0; start < frames; start += CHAIN_FRAMES) {
+        size_t count = std::min(CHAIN_FRAMES, frames - start);
+        for (int c = 0; c < channels; ++c) {
+            std::copy_n(audio.channel(c) + start, count, buffer.channel(c));
+        }
+        run_filters(filters, &buffer, &scratch, count);
+    }
+    double seconds = seconds_since(begin);
+
+    double audio_seconds = frames / sample_rate;
+    return {"chain", "realtime_factor",
+            seconds > 0 ? audio_seconds / seconds : 0};
+}
+
+auto write_json(const fs::path& path, const std::vector<Result>& results)
+    -> void {
+    std::ofstream file(path);
+    file << "{\n  \"version\": 1,\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+        file << std::format(
+            "    {{\"id\": \"{}\", \"metric\": \"{}\", \"value\": {}}}{}\n",
+            result.id, result.metric, result.value,
+            i + 1 < results.size() ? "," : "");
+    }
+    file << "  ]\n}\n";
+}
+
+// Reads back the "results" written by write_json(): flat objects of string
+// and number values
+auto read_json(const fs::path& path) -> std::map<std::string, Result> {
+    std::ifstream file(path);
+    if (!file) throw std::runtime_error("Failed to open " + path.string());
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string text = buffer.str();
+
+    size_t pos = text.find("\"results\"");
+    if (pos == std::string::npos) {
+        throw std::runtime_error(path.string() + ": no \"results\"");
+    }
+
+    auto skip_spaces = [&] {
+        while (pos < text.size() && std::isspace((unsigned char)text[pos])) {
+            pos++;
+        }
+    };
+    auto read_string = [&] {
+        size_t end = text.find('"', pos + 1);
+        std::string value = text.substr(pos + 1, end - pos - 1);
+        pos = end + 1;
+        return value;
+    };
+
+    std::map<std::string, Result> results;
+    pos = text.find('[', pos);
+    while ((pos = text.find_first_of("{]", pos)) != std::string::npos &&
+           text[pos] == '{') {
+        pos++;
+        Result result;
+        skip_spaces();
+        while (text[pos] == '"') {
+            std::string key = read_string();
+            pos = text.find(':', pos) + 1;
+            skip_spaces();
+
+            if (text[pos] == '"') {
+                std::string value = read_string();
+                if (key == "id") result.id = value;
+                if (key == "metric") result.metric = value;
+            } else {
+                size_t length = 0;
+                double value = std::stod(text.substr(pos), &length);
+                pos += length;
+                if (key == "value") result.value = value;
+            }
+
+            skip_spaces();
+            if (text[pos] == ',') pos++;
+            skip_spaces();
+        }
+        results[result.id] = result;
+    }
+    return results;
+}
+
+auto compare(const fs::path& base_path, const fs::path& new_path,
+             double threshold) -> int {
+    auto base = read_json(base_path);
+    auto current = read_json(new_path);
+
+    int regressions = 0;
+    for (const auto& [id, result] : current) {
+        auto it = base.find(id);
+        if (it == base.end() || it->second.value <= 0) {
+            std::print("{:<60} {:>10.2f}   (new)\n", id, result.value);
+            continue;
+        }
+
+        // Positive when slower, whatever the metric
+        double change = (result.value / it->second.value - 1.0) * 100.0;
+        if (result.metric == "realtime_factor") change = -change;
+
+        bool regression = change > threshold;
+        regressions += regression;
+        std::print("{:<60} {:>10.2f} -> {:>10.2f} {:>+8.1f}% slower{}\n", id,
+                   it->second.value, result.value, change,
+                   regression ? "  REGRESSION" : "");
+    }
+
+    std::print("{} regressions over {:.1f}%\n", regressions, threshold);
+    return regressions == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+}  // namespace
+
+auto main(int argc, char** argv) -> int {
+    fs::path root_dir = fs::path(__FILE__).parent_path().parent_path();
+
+    if (argc >= 4 && std::string_view(argv[1]) == "--compare") {
+        double threshold = 10.0;
+        if (argc >= 6 && std::string_view(argv[4]) == "--threshold") {
+            threshold = std::stod(argv[5]);
+        }
+        try {
+            return compare(argv[2], argv[3], threshold);
+        } catch (const std::exception& e) {
+            std::print("[ERROR]: {}\n", e.what());
+            return -1;
+        }
+    }
+
+    fs::path json_path = "bench_results.json";
+    fs::path samples_dir = root_dir / "samples";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string_view arg = argv[i];
+        if (arg == "--json") {
+            json_path = argv[i + 1];
+        } else if (arg == "--samples") {
+            samples_dir = argv[i + 1];
+        }
+    }
+
+    fs::path wisdom_path = root_dir / "fftw.wisdom";
+    FFT::load_wisdom(wisdom_path.string());
+
+    ChainResources resources;
+    fs::path ir_path = root_dir / "samples" / "ir.wav";
+    try {
+        resources.cabinet_ir = std::make_shared<CabinetIR>(ir_path.string());
+    } catch (const std::exception& e) {
+        std::print("[WARN]: No cabinet IR ({}), skipping the cabinet\n",
+                   e.what());
+    }
+
+    std::vector<Result> results = bench_filters(resources);
+
+    for (const auto& file : collect_audio_files(samples_dir)) {
+        // The IR is not a recording
+        if (file.filename() == ir_path.filename()) continue;
+
+        try {
+            Result result = bench_file(file, resources);
+            result.id += " " + fs::relative(file, samples_dir).generic_string();
+            std::print("{:<60} {:>10.1f}x realtime\n", result.id,
+                       result.value);
+            results.push_back(result);
+        } catch (const std::exception& e) {
+            std::print("[WARN]: {}: {}\n", file.string(), e.what());
+        }
+    }
+
+    FFT::save_wisdom(wisdom_path.string());
+
+    write_json(json_path, results);
+    std::print("Wrote {}\n", json_path.string());
+    return EXIT_SUCCESS;
+}
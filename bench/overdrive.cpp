@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <print>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "diode_table.h"
+#include "overdrive.h"
+
+// Checks the DiodeTable and the Newton solver of the Overdrive against the
+// converged solution, then compares the cost per sample of the two
+// scattering modes for several channel counts. The Newton solver starts from
+// a / 2 and stops after 10 iterations, too few for a above ~1.2: only the
+// table is held to a bound.
+
+constexpr float SAMPLE_RATE = 48000.0f;
+constexpr float SIGNAL_SECONDS = 10.0f;
+
+// Range of incident waves a [-1, 1] signal produces, with some headroom
+constexpr float CHECK_RANGE = 4.0f;
+constexpr double TABLE_MAX_ERROR = 1e-5;
+
+struct Accuracy {
+    double table_vs_newton;
+    double table_vs_exact;
+    double newton_vs_exact;
+};
+
+static auto check_accuracy() -> Accuracy {
+    DiodeTable table;
+    Accuracy accuracy = {};
+
+    for (float a = -CHECK_RANGE; a <= CHECK_RANGE; a += 1e-4f) {
+        double slope;
+        double exact = DiodeTable::solve(a, slope);
+        float newton = Overdrive::scattering(a);
+        float lookup = table.lookup(a);
+
+        accuracy.table_vs_newton = std::max<double>(
+            accuracy.table_vs_newton, std::abs(lookup - newton));
+        accuracy.table_vs_exact =
+            std::max(accuracy.table_vs_exact, std::abs(lookup - exact));
+        accuracy.newton_vs_exact =
+            std::max(accuracy.newton_vs_exact, std::abs(newton - exact));
+    }
+
+    return accuracy;
+}
+
+static auto ns_per_sample(ScatteringMode mode, const AudioBuffer& signal)
+    -> double {
+    int channels = signal.get_channels();
+    Overdrive overdrive(1000.0f, SAMPLE_RATE, channels, mode);
+    AudioBuffer output(channels, signal.get_capacity());
+
+    auto begin = std::chrono::steady_clock::now();
+    overdrive.process(signal.view(), output.view());
+    double ns = std::chrono::duration<double, std::nano>(
+                    std::chrono::steady_clock::now() - begin)
+                    .count();
+
+    return ns / (signal.get_capacity() * channels);
+}
+
+auto main() -> int {
+    Accuracy accuracy = check_accuracy();
+    std::print("max |b| error for |a| <= {}:\n", CHECK_RANGE);
+    std::print("  table  vs newton: {:.2e}\n", accuracy.table_vs_newton);
+    std::print("  table  vs exact:  {:.2e} (bound {:.0e})\n",
+               accuracy.table_vs_exact, TABLE_MAX_ERROR);
+    std::print("  newton vs exact:  {:.2e}\n", accuracy.newton_vs_exact);
+
+    // A guitar-like signal: decaying plucks over noise, peaking at 1
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+    std::vector<float> mono(SIGNAL_SECONDS * SAMPLE_RATE);
+    for (size_t i = 0; i < mono.size(); ++i) {
+        float t = std::fmod(i / SAMPLE_RATE, 0.5f);
+        mono[i] = std::exp(-6.0f * t) * std::sin(2.0f * 3.14159f * 196.0f * t) +
+                  noise(rng);
+    }
+
+    std::print("\n{:>9} {:>14} {:>14} {:>9}\n", "channels", "newton [ns]",
+               "table [ns]", "speedup");
+    for (int channels : {1, 2, 8}) {
+        AudioBuffer signal(channels, mono.size());
+        for (int c = 0; c < channels; ++c) {
+            std::copy(mono.begin(), mono.end(), signal.channel(c));
+        }
+
+        double newton = ns_per_sample(ScatteringMode::newton, signal);
+        double table = ns_per_sample(ScatteringMode::table, signal);
+        std::print("{:>9} {:>14.2f} {:>14.2f} {:>8.1f}x\n", channels, newton,
+                   table, newton / table);
+    }
+
+    return accuracy.table_vs_exact <= TABLE_MAX_ERROR ? EXIT_SUCCESS
+                                                       : EXIT_FAILURE;
+}
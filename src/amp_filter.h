@@ -1,13 +1,42 @@
 #pragma once
 
+#include <span>
 #include <string>
 #include <typeinfo>
 #include <vector>
+
+#include "audio_buffer.h"
+
 class AMPFilter {
    public:
     virtual ~AMPFilter() = default;
-    virtual auto apply(const std::vector<float>& input)
-        -> std::vector<float> = 0;
+
+    // Allocation-free entry point. Reads the get_in_channels() planar channels
+    // of `input` and writes the same amount of frames, with
+    // get_out_channels() channels, into `output`.
+    // When both channel counts are equal `input` and `output` may be the same
+    // buffer (in place processing).
+    virtual auto process(ConstAudioView input, AudioView output) -> void = 0;
+
+    virtual auto get_in_channels() -> int = 0;
+    virtual auto get_out_channels() -> int { return get_in_channels(); }
+
+    // Frames between an input frame and its processed output frame
+    virtual auto get_latency() -> int { return 0; }
+
+    // Convenience wrapper around process() for interleaved audio, allocates
+    // the planar buffers and the output
+    virtual auto apply(const std::vector<float>& input) -> std::vector<float> {
+        size_t frame_count = input.size() / get_in_channels();
+        AudioBuffer in(get_in_channels(), frame_count);
+        AudioBuffer out(get_out_channels(), frame_count);
+        deinterleave(input, in.view());
+        process(in.view(), out.view());
+
+        std::vector<float> output(frame_count * get_out_channels());
+        interleave(out.view(), output);
+        return output;
+    }
 
     // By default returns "../output/{in_file_name}/audio.wav"
     virtual auto get_output_dir(const std::string& audio_name) -> std::string {
@@ -0,0 +1,39 @@
+#include "audio_buffer.h"
+
+#include <algorithm>
+
+auto AudioBuffer::resize(int channels, size_t capacity) -> void {
+    constexpr size_t ALIGNED_FLOATS = ALIGNMENT / sizeof(float);
+
+    this->channels = channels;
+    this->capacity = capacity;
+    stride = (capacity + ALIGNED_FLOATS - 1) / ALIGNED_FLOATS * ALIGNED_FLOATS;
+
+    size_t size = stride * channels;
+    samples.reset(size > 0 ? static_cast<float*>(::operator new[](
+                                 size * sizeof(float),
+                                 std::align_val_t(ALIGNMENT)))
+                           : nullptr);
+    std::fill_n(samples.get(), size, 0.0f);
+}
+
+auto deinterleave(std::span<const float> interleaved, AudioView planar)
+    -> void {
+    int channels = planar.get_channels();
+    for (int c = 0; c < channels; ++c) {
+        float* out = planar.channel(c).data();
+        for (size_t i = 0; i < planar.get_frames(); ++i) {
+            out[i] = interleaved[i * channels + c];
+        }
+    }
+}
+
+auto interleave(ConstAudioView planar, std::span<float> interleaved) -> void {
+    int channels = planar.get_channels();
+    for (int c = 0; c < channels; ++c) {
+        const float* in = planar.channel(c).data();
+        for (size_t i = 0; i < planar.get_frames(); ++i) {
+            interleaved[i * channels + c] = in[i];
+        }
+    }
+}
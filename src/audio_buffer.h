@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+
+// Non-owning view of `frames` frames of planar (deinterleaved) audio.
+// Channel c starts at data + c * stride. T is float or const float.
+template <typename T>
+class BasicAudioView {
+   public:
+    BasicAudioView() = default;
+    BasicAudioView(T* data, int channels, size_t frames, size_t stride)
+        : samples(data), channels(channels), frames(frames), stride(stride) {}
+
+    // Writable views are readable ones
+    template <typename U>
+        requires(std::is_same_v<const U, T> && !std::is_same_v<U, T>)
+    BasicAudioView(const BasicAudioView<U>& other)
+        : BasicAudioView(other.data(), other.get_channels(),
+                         other.get_frames(), other.get_stride()) {}
+
+    auto get_channels() const -> int { return channels; }
+    auto get_frames() const -> size_t { return frames; }
+    auto get_stride() const -> size_t { return stride; }
+    auto data() const -> T* { return samples; }
+
+    auto channel(int c) const -> std::span<T> {
+        return {samples + c * stride, frames};
+    }
+
+    // `count` frames from `offset` on
+    auto subview(size_t offset, size_t count) const -> BasicAudioView {
+        return {samples + offset, channels, count, stride};
+    }
+
+   private:
+    T* samples = nullptr;
+    int channels = 0;
+    size_t frames = 0;
+    size_t stride = 0;
+};
+
+using AudioView = BasicAudioView<float>;
+using ConstAudioView = BasicAudioView<const float>;
+
+// Planar audio: every channel is a contiguous array of get_capacity() frames,
+// aligned to a cache line, so per channel loops vectorize. All the storage is
+// allocated in the constructor (or resize()) and zeroed.
+class AudioBuffer {
+   public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    AudioBuffer() = default;
+    AudioBuffer(int channels, size_t capacity) { resize(channels, capacity); }
+
+    // Drops the content
+    auto resize(int channels, size_t capacity) -> void;
+
+    auto get_channels() const -> int { return channels; }
+    auto get_capacity() const -> size_t { return capacity; }
+
+    auto channel(int c) -> float* { return samples.get() + c * stride; }
+    auto channel(int c) const -> const float* {
+        return samples.get() + c * stride;
+    }
+
+    // The first `channels` channels, `frames` frames long
+    auto view(int channels, size_t frames) -> AudioView {
+        return {samples.get(), channels, frames, stride};
+    }
+    auto view(int channels, size_t frames) const -> ConstAudioView {
+        return {samples.get(), channels, frames, stride};
+    }
+
+    auto view() -> AudioView { return view(channels, capacity); }
+    auto view() const -> ConstAudioView { return view(channels, capacity); }
+
+   private:
+    struct AlignedDelete {
+        auto operator()(float* ptr) const -> void {
+            ::operator delete[](ptr, std::align_val_t(ALIGNMENT));
+        }
+    };
+
+    std::unique_ptr<float[], AlignedDelete> samples;
+    int channels = 0;
+    size_t capacity = 0;
+
+    // Channel distance, rounded up to keep every channel aligned
+    size_t stride = 0;
+};
+
+// Interleaving, for the file I/O boundary: `interleaved` holds
+// planar.get_frames() frames of planar.get_channels() channels
+auto deinterleave(std::span<const float> interleaved, AudioView planar)
+    -> void;
+auto interleave(ConstAudioView planar, std::span<float> interleaved) -> void;
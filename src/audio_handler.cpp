@@ -2,9 +2,31 @@
 
 #include <sndfile.h>
 
+#include <algorithm>
 #include <print>
 
+#include "trace.h"
+
 auto AudioFileHandler::open_read(const std::string &path) -> bool {
+    if (wav_map.open(path)) {
+        int subtype = SF_FORMAT_FLOAT;
+        if (wav_map.get_format() == WavMap::SampleFormat::pcm16) {
+            subtype = SF_FORMAT_PCM_16;
+        } else if (wav_map.get_format() == WavMap::SampleFormat::pcm24) {
+            subtype = SF_FORMAT_PCM_24;
+        }
+
+        sf_info_in = {};
+        sf_info_in.frames = wav_map.get_total_frames();
+        sf_info_in.samplerate = wav_map.get_sample_rate();
+        sf_info_in.channels = wav_map.get_channels();
+        sf_info_in.format = SF_FORMAT_WAV | subtype;
+        sf_info_in.sections = 1;
+        sf_info_in.seekable = 1;
+        map_position = 0;
+        return true;
+    }
+
     file_in = sf_open(path.c_str(), SFM_READ, &sf_info_in);
     if (!file_in) {
         std::print(stderr, "Error opening file: {}\n", sf_strerror(NULL));
@@ -15,8 +37,14 @@ auto AudioFileHandler::open_read(const std::string &path) -> bool {
 
 auto AudioFileHandler::open_write(const std::string &path,
                                   uint8_t channel_count) -> bool {
-    this->sf_info_out = sf_info_in;
-    if (channel_count > 0) sf_info_out.channels = channel_count;
+    SF_INFO info = sf_info_in;
+    if (channel_count > 0) info.channels = channel_count;
+    return open_write(path, info);
+}
+
+auto AudioFileHandler::open_write(const std::string &path, const SF_INFO &info)
+    -> bool {
+    this->sf_info_out = info;
     file_out = sf_open(path.c_str(), SFM_WRITE, &sf_info_out);
     if (!file_out) {
         std::print(stderr, "Error opening file: {}\n", sf_strerror(NULL));
@@ -25,26 +53,174 @@ auto AudioFileHandler::open_write(const std::string &path,
     return true;
 }
 
-auto AudioFileHandler::read_frames(float *buffer, sf_count_t frames)
+AudioFileHandler::Stream::Stream(size_t block_samples, size_t depth)
+    : blocks(depth), free(depth + 1), full(depth + 1) {
+    // Both queues can hold every block plus the stop marker, so the I/O
+    // threads never wait on a push
+    for (auto &block : blocks) {
+        block.samples.resize(block_samples);
+        free.push(&block);
+    }
+}
+
+auto AudioFileHandler::start_streaming(size_t block_frames, size_t depth)
+    -> void {
+    if ((file_in || wav_map.is_open()) && !reader) {
+        reader = std::make_unique<Stream>(block_frames * sf_info_in.channels,
+                                          depth);
+        reader->worker = std::jthread([this, stream = reader.get(),
+                                       block_frames] {
+            trace::set_thread_name("reader");
+            while (StreamBlock *block = stream->free.pop()) {
+                block->frames = read_file(block->samples.data(), block_frames);
+                block->offset = 0;
+                stream->full.push(block);
+
+                // An empty block marks the end of the file
+                if (block->frames == 0) break;
+            }
+        });
+    }
+
+    if (file_out && !writer) {
+        writer = std::make_unique<Stream>(block_frames * sf_info_out.channels,
+                                          depth);
+        writer->worker = std::jthread([this, stream = writer.get()] {
+            trace::set_thread_name("writer");
+            while (StreamBlock *block = stream->full.pop()) {
+                if (write_file(block->samples.data(), block->frames) !=
+                    block->frames) {
+                    stream->failed = true;
+                }
+                stream->free.push(block);
+            }
+        });
+    }
+}
+
+auto AudioFileHandler::read_file(float *buffer, sf_count_t frames)
     -> sf_count_t {
+    trace::Span span("read", trace::Category::io, frames);
+    if (wav_map.is_open()) {
+        size_t count = wav_map.read(map_position, buffer, frames);
+        map_position += count;
+        return count;
+    }
     return sf_readf_float(file_in, buffer, frames);
 }
 
-auto AudioFileHandler::write_frames(float *buffer, sf_count_t frames)
+auto AudioFileHandler::write_file(const float *buffer, sf_count_t frames)
     -> sf_count_t {
+    trace::Span span("write", trace::Category::io, frames);
     return sf_writef_float(file_out, buffer, frames);
 }
 
-auto AudioFileHandler::close(bool in_file) -> void {
+auto AudioFileHandler::read_frames(float *buffer, sf_count_t frames)
+    -> sf_count_t {
+    if (!reader) return read_file(buffer, frames);
+
+    int channels = sf_info_in.channels;
+    sf_count_t done = 0;
+    while (done < frames && !reader->ended) {
+        if (!reader->current) reader->current = reader->full.pop();
+
+        StreamBlock *block = reader->current;
+        if (block->frames == 0) {
+            reader->ended = true;
+            break;
+        }
+
+        sf_count_t count =
+            std::min(frames - done, block->frames - block->offset);
+        std::copy_n(block->samples.data() + block->offset * channels,
+                    count * channels, buffer + done * channels);
+        block->offset += count;
+        done += count;
+
+        if (block->offset == block->frames) {
+            reader->free.push(block);
+            reader->current = nullptr;
+        }
+    }
+    return done;
+}
+
+auto AudioFileHandler::write_frames(const float *buffer, sf_count_t frames)
+    -> sf_count_t {
+    if (!writer) {
+        sf_count_t written = write_file(buffer, frames);
+        if (written != frames) write_failed = true;
+        return written;
+    }
+    if (writer->failed) return 0;
+
+    int channels = sf_info_out.channels;
+    sf_count_t block_frames = writer->blocks.front().samples.size() / channels;
+    sf_count_t done = 0;
+    while (done < frames) {
+        // Waits while every block is being written
+        if (!writer->current) {
+            writer->current = writer->free.pop();
+            writer->current->frames = 0;
+        }
+
+        StreamBlock *block = writer->current;
+        sf_count_t count =
+            std::min(frames - done, block_frames - block->frames);
+        std::copy_n(buffer + done * channels, count * channels,
+                    block->samples.data() + block->frames * channels);
+        block->frames += count;
+        done += count;
+
+        if (block->frames == block_frames) {
+            writer->full.push(block);
+            writer->current = nullptr;
+        }
+    }
+    return done;
+}
+
+auto AudioFileHandler::read_frames(AudioView out) -> sf_count_t {
+    interleaved.resize(out.get_frames() * out.get_channels());
+    sf_count_t frames = read_frames(interleaved.data(), out.get_frames());
+    deinterleave(interleaved, out.subview(0, frames));
+    return frames;
+}
+
+auto AudioFileHandler::write_frames(ConstAudioView in) -> sf_count_t {
+    interleaved.resize(in.get_frames() * in.get_channels());
+    interleave(in, interleaved);
+    return write_frames(interleaved.data(), in.get_frames());
+}
+
+auto AudioFileHandler::close(bool in_file) -> bool {
     if (in_file) {
+        if (reader) {
+            reader->free.push(nullptr);
+            reader.reset();  // joins
+        }
+        wav_map.close();
         if (file_in) {
             sf_close(file_in);
             file_in = nullptr;
         }
-    } else {
-        if (file_out) {
-            sf_close(file_out);
-            file_out = nullptr;
+        return true;
+    }
+
+    bool ok = !write_failed;
+    write_failed = false;
+    if (writer) {
+        if (writer->current && writer->current->frames > 0) {
+            writer->full.push(writer->current);
         }
+        writer->full.push(nullptr);
+        writer->worker.join();
+        ok = ok && !writer->failed;
+        writer.reset();
+    }
+    if (file_out) {
+        ok = sf_close(file_out) == 0 && ok;
+        file_out = nullptr;
     }
+    return ok;
 }
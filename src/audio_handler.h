@@ -2,39 +2,109 @@
 
 #include <sndfile.h>
 
+#include <atomic>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
+
+#include "audio_buffer.h"
+#include "spsc_queue.h"
+#include "wav_map.h"
 
 class AudioFileHandler {
    private:
     SNDFILE *file_in, *file_out;
     SF_INFO sf_info_in, sf_info_out;
 
+    // Replaces file_in for the WAV files it can map
+    WavMap wav_map;
+    size_t map_position = 0;
+
+    // A block of interleaved frames travelling between a file and the caller
+    struct StreamBlock {
+        std::vector<float> samples;
+        sf_count_t frames = 0;
+
+        // Frames already taken by read_frames()
+        sf_count_t offset = 0;
+    };
+
+    // One streamed direction: `depth` preallocated blocks circulate between
+    // the caller and an I/O thread. A nullptr block stops the thread.
+    struct Stream {
+        std::vector<StreamBlock> blocks;
+        SPSCQueue<StreamBlock *> free, full;
+
+        // The block being read from / written into by the caller
+        StreamBlock *current = nullptr;
+        bool ended = false;
+
+        std::atomic<bool> failed = false;
+        std::jthread worker;
+
+        Stream(size_t block_samples, size_t depth);
+    };
+
+    std::unique_ptr<Stream> reader, writer;
+
+    // An unstreamed write_frames() wrote fewer frames than it was given
+    bool write_failed = false;
+
+    // Interleaved frames of the planar read_frames() / write_frames(), grown
+    // to the largest call
+    std::vector<float> interleaved;
+
+    auto read_file(float *buffer, sf_count_t frames) -> sf_count_t;
+    auto write_file(const float *buffer, sf_count_t frames) -> sf_count_t;
+
    public:
    public:
     AudioFileHandler() : file_in(nullptr), file_out(nullptr) {
-        sf_info_in = {0};
-        sf_info_out = {0};
+        sf_info_in = {};
+        sf_info_out = {};
     }
     ~AudioFileHandler() {
         close(true);
         close(false);
     }
 
-    // opens the file to be read from
+    // opens the file to be read from, mapped in memory when it is a 16/24 bit
+    // PCM or float32 WAV file
     auto open_read(const std::string &path) -> bool;
 
     // opens the file to write to
     auto open_write(const std::string &path, uint8_t channel_count = 0) -> bool;
 
+    // opens the file to write to, with an explicit format (see get_info)
+    auto open_write(const std::string &path, const SF_INFO &info) -> bool;
+
+    // Moves the decoding and encoding of the open files to I/O threads: up to
+    // `depth` blocks of `block_frames` frames are read ahead of read_frames()
+    // and written behind write_frames(), which then only copy, unless the
+    // I/O thread fell behind. Without it every call goes to the file.
+    // A mapped input is read ahead too: its page faults and PCM conversion
+    // stay off the calling thread.
+    auto start_streaming(size_t block_frames, size_t depth = 8) -> void;
+
     // Read a block of samples (Interleaved: L, R, L, R...)
     auto read_frames(float *buffer, sf_count_t frames) -> sf_count_t;
 
     // Write a block of samples
-    auto write_frames(float *buffer, sf_count_t frames) -> sf_count_t;
+    auto write_frames(const float *buffer, sf_count_t frames) -> sf_count_t;
+
+    // Planar versions: up to out.get_frames() frames of every channel of the
+    // file, all the frames of `in`
+    auto read_frames(AudioView out) -> sf_count_t;
+    auto write_frames(ConstAudioView in) -> sf_count_t;
 
     int get_channels() const { return sf_info_in.channels; }
     int get_sample_rate() const { return sf_info_in.samplerate; }
     sf_count_t get_total_frames() const { return sf_info_in.frames; }
+    const SF_INFO &get_info() const { return sf_info_in; }
 
-    auto close(bool in_file) -> void;
+    // Closing a streamed output waits for its pending blocks to be written.
+    // Returns false when a frame of the output could not be written or the
+    // file could not be finalized (always true for the input).
+    auto close(bool in_file) -> bool;
 };
@@ -0,0 +1,142 @@
+#include "batch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <map>
+
+#include "audio_handler.h"
+#include "thread_pool.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr size_t FRAMES_COUNT = 4096;
+
+auto render_file(BatchResult& result, const std::vector<std::string>& names,
+                 const ChainResources& resources,
+                 const std::optional<SpectrogramOptions>& spectrogram_options)
+    -> void {
+    auto start = std::chrono::steady_clock::now();
+
+    AudioFileHandler fh;
+    if (!fh.open_read(result.input.string())) {
+        result.error = "Failed to open input";
+        return;
+    }
+
+    int channels = fh.get_channels();
+    float sample_rate = fh.get_sample_rate();
+
+    auto chain = make_chain(names, channels, sample_rate, resources);
+    std::vector<AMPFilter*> filters;
+    for (const auto& filter : chain) filters.push_back(filter.get());
+
+    int out_channels = chain.empty() ? channels
+                                     : chain.back()->get_out_channels();
+
+    fs::create_directories(result.output.parent_path());
+    if (!fh.open_write(result.output.string(), out_channels)) {
+        result.error = "Failed to open output";
+        return;
+    }
+    fh.start_streaming(FRAMES_COUNT);
+
+    int max_channels = get_max_channels(filters, channels);
+    AudioBuffer process_buffer(max_channels, FRAMES_COUNT);
+    AudioBuffer scratch_buffer(max_channels, FRAMES_COUNT);
+
+    std::optional<Spectrogram> spectrogram;
+    if (spectrogram_options) {
+        spectrogram.emplace(out_channels, sample_rate, *spectrogram_options);
+    }
+
+    size_t total_frames = 0;
+    size_t read_count = 0;
+    while ((read_count = fh.read_frames(
+                process_buffer.view(channels, FRAMES_COUNT))) > 0) {
+        const AudioBuffer* out = run_filters(filters, &process_buffer,
+                                             &scratch_buffer, read_count);
+        fh.write_frames(out->view(out_channels, read_count));
+        if (spectrogram) {
+            spectrogram->push(out->view(out_channels, read_count));
+        }
+        total_frames += read_count;
+    }
+
+    if (!fh.close(false)) {
+        result.error = "Failed to write output";
+        return;
+    }
+
+    if (spectrogram) {
+        spectrogram->finish();
+        spectrogram->write_images(result.output.parent_path());
+    }
+
+    result.audio_seconds = total_frames / sample_rate;
+    result.wall_seconds = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+}
+}  // namespace
+
+auto collect_audio_files(const fs::path& path) -> std::vector<fs::path> {
+    if (!fs::is_directory(path)) return {path};
+
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::recursive_directory_iterator(path)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".wav") {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+auto get_audio_name(const fs::path& path) -> std::string {
+    if (path.stem() == "audio" && path.has_parent_path()) {
+        return path.parent_path().filename().string();
+    }
+    return path.stem().string();
+}
+
+auto run_batch(const std::vector<fs::path>& inputs,
+               const fs::path& output_root,
+               const std::vector<std::string>& chain,
+               const ChainResources& resources, size_t thread_count,
+               const std::optional<SpectrogramOptions>& spectrogram)
+    -> std::vector<BatchResult> {
+    std::vector<BatchResult> results(inputs.size());
+
+    // Inputs with the same name (e.g. "a/take.wav" and "b/take.wav") would
+    // write the same output concurrently, only the first one is rendered
+    std::map<fs::path, fs::path> first_inputs;
+
+    ThreadPool pool(thread_count);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        results[i].input = inputs[i];
+        results[i].output =
+            output_root / get_audio_name(inputs[i]) / "audio.wav";
+
+        auto [first, inserted] =
+            first_inputs.emplace(results[i].output, inputs[i]);
+        if (!inserted) {
+            results[i].error =
+                "Same output as " + first->second.string() + ", not rendered";
+            continue;
+        }
+
+        pool.submit([&result = results[i], &chain, &resources,
+                     &spectrogram] {
+            try {
+                render_file(result, chain, resources, spectrogram);
+            } catch (const std::exception& e) {
+                result.error = e.what();
+            }
+        });
+    }
+    pool.wait();
+
+    return results;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "filter_chain.h"
+#include "spectrogram.h"
+
+struct BatchResult {
+    std::filesystem::path input, output;
+    double audio_seconds = 0;
+    double wall_seconds = 0;
+
+    // Empty when the file was rendered
+    std::string error;
+
+    auto get_realtime_factor() const -> double {
+        return wall_seconds > 0 ? audio_seconds / wall_seconds : 0;
+    }
+};
+
+// The .wav files under `path` (recursively) or `path` itself if it is a file
+auto collect_audio_files(const std::filesystem::path& path)
+    -> std::vector<std::filesystem::path>;
+
+// "samples/{name}/audio.wav" -> "{name}", any other file -> its stem
+auto get_audio_name(const std::filesystem::path& path) -> std::string;
+
+// Renders every input through its own instance of `chain`, concurrently on a
+// work-stealing thread pool. The output of an input goes to
+// "{output_root}/{get_audio_name(input)}/audio.wav". An input whose output
+// is the one of an earlier input fails with an error instead.
+// The results are in the order of `inputs`.
+// With `spectrogram` the spectrograms of every output are computed from the
+// rendered blocks and written next to it.
+auto run_batch(const std::vector<std::filesystem::path>& inputs,
+               const std::filesystem::path& output_root,
+               const std::vector<std::string>& chain,
+               const ChainResources& resources, size_t thread_count,
+               const std::optional<SpectrogramOptions>& spectrogram = {})
+    -> std::vector<BatchResult>;
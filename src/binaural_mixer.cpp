@@ -0,0 +1,241 @@
+#include "binaural_mixer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <numbers>
+#include <stdexcept>
+
+#include "head_model.h"
+
+namespace {
+constexpr double TWO_PI = 2.0 * std::numbers::pi;
+}  // namespace
+
+BinauralMixer::BinauralMixer(std::vector<BinauralSource> sources,
+                             uint32_t sample_rate, bool woodworth_delay,
+                             bool apply_svf)
+    : sources(std::move(sources)),
+      source_count(this->sources.size()),
+      lane_count((source_count + LANES - 1) / LANES * LANES),
+      sample_rate(sample_rate),
+      woodworth_delay(woodworth_delay),
+      apply_svf(apply_svf) {
+    if (source_count == 0) {
+        throw std::invalid_argument("binaural_mixer: no source");
+    }
+
+    // The padding lanes stay silent, in front, without moving
+    curr_angle.assign(lane_count, 0.0);
+    angle_step.assign(lane_count, 0.0f);
+    angle_cos.assign(lane_count, 1.0f);
+    angle_sin.assign(lane_count, 0.0f);
+    gain_cos.assign(lane_count, 0.0f);
+    gain_sin.assign(lane_count, 0.0f);
+    for (auto* table : {&rot_cos, &gain_rot_cos}) {
+        table->assign((CONTROL_BLOCK + 1) * lane_count, 1.0f);
+    }
+    for (auto* table : {&rot_sin, &gain_rot_sin}) {
+        table->assign((CONTROL_BLOCK + 1) * lane_count, 0.0f);
+    }
+
+    for (int s = 0; s < source_count; ++s) {
+        const BinauralSource& source = this->sources[s];
+        double angle = std::fmod((double)source.azimuth, TWO_PI);
+        curr_angle[s] = angle < 0.0 ? angle + TWO_PI : angle;
+        angle_cos[s] = std::cos(curr_angle[s]);
+        angle_sin[s] = std::sin(curr_angle[s]);
+        gain_cos[s] = std::cos(0.5 * curr_angle[s] + 0.25 * std::numbers::pi);
+        gain_sin[s] = std::sin(0.5 * curr_angle[s] + 0.25 * std::numbers::pi);
+
+        // In double so every frame of a block is exact to float precision
+        double step = (double)source.rotation_speed / sample_rate;
+        angle_step[s] = step;
+        for (int i = 0; i <= CONTROL_BLOCK; ++i) {
+            rot_cos[i * lane_count + s] = std::cos(i * step);
+            rot_sin[i * lane_count + s] = std::sin(i * step);
+            gain_rot_cos[i * lane_count + s] = std::cos(0.5 * i * step);
+            gain_rot_sin[i * lane_count + s] = std::sin(0.5 * i * step);
+        }
+    }
+
+    delay_line.assign(DELAY_SIZE * lane_count, 0.0f);
+    svfs_l.resize(lane_count / LANES);
+    svfs_r.resize(lane_count / LANES);
+}
+
+auto BinauralMixer::set_svf_targets() -> void {
+    // Cutoffs of the angles reached at the end of the control block
+    const float* end_cos = rot_cos.data() + CONTROL_BLOCK * lane_count;
+    const float* end_sin = rot_sin.data() + CONTROL_BLOCK * lane_count;
+
+    for (size_t s = 0; s < lane_count; ++s) {
+        float cos_val = angle_cos[s] * end_cos[s] - angle_sin[s] * end_sin[s];
+        float sin_val = angle_sin[s] * end_cos[s] + angle_cos[s] * end_sin[s];
+        auto [cutoff_l, cutoff_r] =
+            head_model::shadow_cutoffs(cos_val, sin_val);
+
+        svfs_l[s / LANES].set_target(s % LANES, cutoff_l,
+                                     head_model::SHADOW_RESONANCE);
+        svfs_r[s / LANES].set_target(s % LANES, cutoff_r,
+                                     head_model::SHADOW_RESONANCE);
+    }
+
+    for (auto& svf : svfs_l) svf.glide(CONTROL_BLOCK);
+    for (auto& svf : svfs_r) svf.glide(CONTROL_BLOCK);
+}
+
+auto BinauralMixer::process_block(float* left, float* right, int frames)
+    -> void {
+    constexpr float PI = std::numbers::pi_v<float>;
+    const auto rate = (float)sample_rate;
+
+    // Locals, so the lane loops don't reload them after every store
+    const float* a_cos = angle_cos.data();
+    const float* a_sin = angle_sin.data();
+    const float* g_cos = gain_cos.data();
+    const float* g_sin = gain_sin.data();
+    const double* start_angle = curr_angle.data();
+    const float* step = angle_step.data();
+    const float* history = delay_line.data();
+    const size_t stride = lane_count;
+    const bool woodworth = woodworth_delay;
+
+    for (int i = 0; i < frames; ++i) {
+        const float* r_cos = rot_cos.data() + i * stride;
+        const float* r_sin = rot_sin.data() + i * stride;
+        const float* gr_cos = gain_rot_cos.data() + i * stride;
+        const float* gr_sin = gain_rot_sin.data() + i * stride;
+        int now = write_index + i;
+        const float* current = history + (now & DELAY_MASK) * stride;
+
+        alignas(32) std::array<float, LANES> sum_l = {}, sum_r = {};
+        for (size_t group = 0; group < stride; group += LANES) {
+            alignas(32) std::array<float, LANES> ear_l, ear_r, gain_l, gain_r;
+
+            for (size_t lane = 0; lane < LANES; ++lane) {
+                size_t s = group + lane;
+                float sin_val = a_sin[s] * r_cos[s] + a_cos[s] * r_sin[s];
+
+                // Into [0, 2 pi) for the fold, a block moves less than a turn
+                float angle = (float)start_angle[s] + i * step[s];
+                angle = angle >= 2.0f * PI ? angle - 2.0f * PI : angle;
+                angle = angle < 0.0f ? angle + 2.0f * PI : angle;
+
+                float itd =
+                    head_model::itd_frames(head_model::fold_to_median(angle),
+                                           sin_val, rate, woodworth);
+
+                // The far ear is delayed, linearly interpolated between the
+                // two frames around its delay. The near one hears the input.
+                auto whole = (int)itd;
+                int newer = now - whole;
+                float newer_val = history[(newer & DELAY_MASK) * stride + s];
+                float older_val =
+                    history[((newer - 1) & DELAY_MASK) * stride + s];
+                float far = newer_val + (itd - whole) * (older_val - newer_val);
+                float near = current[s];
+
+                bool is_on_right = sin_val > 0;
+                ear_l[lane] = is_on_right ? far : near;
+                ear_r[lane] = is_on_right ? near : far;
+
+                gain_l[lane] =
+                    std::abs(g_cos[s] * gr_cos[s] - g_sin[s] * gr_sin[s]);
+                gain_r[lane] =
+                    std::abs(g_sin[s] * gr_cos[s] + g_cos[s] * gr_sin[s]);
+            }
+
+            // Head shadow
+            if (apply_svf) {
+                svfs_l[group / LANES].process(ear_l, ear_l,
+                                              PassFilterTypes::low_pass);
+                svfs_r[group / LANES].process(ear_r, ear_r,
+                                              PassFilterTypes::low_pass);
+            }
+
+            for (size_t lane = 0; lane < LANES; ++lane) {
+                sum_l[lane] += ear_l[lane] * gain_l[lane];
+                sum_r[lane] += ear_r[lane] * gain_r[lane];
+            }
+        }
+
+        for (size_t lane = 0; lane < LANES; ++lane) {
+            left[i] += sum_l[lane];
+            right[i] += sum_r[lane];
+        }
+    }
+
+    write_index = (write_index + frames) & DELAY_MASK;
+
+    // Advance the phasors, renormalized so rounding can't make them drift
+    auto rotate = [&](std::vector<float>& c, std::vector<float>& s,
+                      const std::vector<float>& rot_c,
+                      const std::vector<float>& rot_s) {
+        const float* block_c = rot_c.data() + frames * stride;
+        const float* block_s = rot_s.data() + frames * stride;
+        for (size_t lane = 0; lane < stride; ++lane) {
+            float next_c = c[lane] * block_c[lane] - s[lane] * block_s[lane];
+            float next_s = s[lane] * block_c[lane] + c[lane] * block_s[lane];
+            float norm = 1.0f / std::sqrt(next_c * next_c + next_s * next_s);
+            c[lane] = next_c * norm;
+            s[lane] = next_s * norm;
+        }
+    };
+    rotate(angle_cos, angle_sin, rot_cos, rot_sin);
+    rotate(gain_cos, gain_sin, gain_rot_cos, gain_rot_sin);
+
+    for (size_t s = 0; s < stride; ++s) {
+        double angle = curr_angle[s] + frames * (double)angle_step[s];
+        angle = angle >= TWO_PI ? angle - TWO_PI : angle;
+        curr_angle[s] = angle < 0.0 ? angle + TWO_PI : angle;
+    }
+}
+
+auto BinauralMixer::process(ConstAudioView input, AudioView output) -> void {
+    size_t frame_count = input.get_frames();
+
+    for (size_t start = 0; start < frame_count;) {
+        if (control_left == 0) {
+            if (apply_svf) set_svf_targets();
+            control_left = CONTROL_BLOCK;
+        }
+        int count = std::min<size_t>(control_left, frame_count - start);
+        control_left -= count;
+
+        // Every source into its lane of the history, before the output is
+        // written: with two sources it runs in place
+        for (int s = 0; s < source_count; ++s) {
+            auto samples = input.channel(s).subspan(start, count);
+            for (int i = 0; i < count; ++i) {
+                delay_line[((write_index + i) & DELAY_MASK) * lane_count + s] =
+                    samples[i];
+            }
+        }
+
+        float* left = output.channel(0).data() + start;
+        float* right = output.channel(1).data() + start;
+        std::fill_n(left, count, 0.0f);
+        std::fill_n(right, count, 0.0f);
+        process_block(left, right, count);
+        start += count;
+    }
+}
+
+auto BinauralMixer::get_filter_name() -> std::string {
+    return "binaural_mixer";
+}
+
+auto BinauralMixer::get_output_dir(const std::string& audio_name)
+    -> std::string {
+    namespace fs = std::filesystem;
+    // Named after the first source's speed, make_filter's sources share it
+    std::string params_str = std::format(
+        "{}_{:.2f}_{:.2f}_{:.2f}", source_count, sources.front().rotation_speed,
+        (float)woodworth_delay, (float)apply_svf);
+
+    fs::path audio_out_path =
+        fs::path(get_filter_name()) / audio_name / params_str;
+    return audio_out_path.string();
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "amp_filter.h"
+#include "svf_bank.h"
+
+// One mono source of a BinauralMixer
+struct BinauralSource {
+    float azimuth = 0.0f;  // radians, clockwise from the front
+    float rotation_speed = 0.0f;  // radians per second, clockwise
+};
+
+// Binaural rendering of N moving mono sources (its input channels) mixed
+// into one stereo output, through the head model of BinauralPanner (ITD,
+// ILD and head shadow, see head_model.h).
+//
+// The sources run in lock-step, LANES at a time: their phasors, delay lines
+// and head shadow SVFs are stored as arrays, so every step of a frame is one
+// loop over the lanes that compiles to SIMD instructions, and the ears of all
+// the sources are summed straight into the output. The trajectories are
+// rotated phasors as in BinauralPanner, no trig per frame.
+//
+// The ILD gains are BinauralPanner's in absolute value: their polarity
+// doesn't flip once per turn of the source.
+class BinauralMixer : public AMPFilter {
+   public:
+    BinauralMixer(std::vector<BinauralSource> sources, uint32_t sample_rate,
+                  bool woodworth_delay = true, bool apply_svf = true);
+
+    auto process(ConstAudioView input, AudioView output) -> void override;
+    auto get_in_channels() -> int override { return source_count; }
+    auto get_out_channels() -> int override { return 2; }
+    auto get_output_dir(const std::string& audio_name) -> std::string override;
+    auto get_filter_name() -> std::string override;
+
+   private:
+    // Sources per SVF bank, one AVX register
+    static constexpr size_t LANES = 8;
+
+    // Head shadow cutoffs are updated once per control block
+    static constexpr int CONTROL_BLOCK = 32;
+
+    // Input history of every source, as in BinauralPanner
+    static constexpr int DELAY_SIZE = 1024;
+    static constexpr int DELAY_MASK = DELAY_SIZE - 1;
+
+    std::vector<BinauralSource> sources;
+    int source_count;
+    // Padded to a multiple of LANES with silent sources
+    size_t lane_count;
+    uint32_t sample_rate;
+    bool woodworth_delay, apply_svf;
+
+    // Per source (structure of arrays, lane_count long): the angle, summed
+    // in double as in BinauralPanner, its step per frame, and the phasors of
+    // the angle and of the ILD angle angle / 2 + pi / 4
+    std::vector<double> curr_angle;
+    std::vector<float> angle_step, angle_cos, angle_sin, gain_cos, gain_sin;
+
+    // Rotations of the phasors of every source by 0..CONTROL_BLOCK frames,
+    // row `frames` of lane_count values
+    std::vector<float> rot_cos, rot_sin, gain_rot_cos, gain_rot_sin;
+
+    // Interleaved input history: row `frame` holds the lane_count sources
+    std::vector<float> delay_line;
+    int write_index = 0;
+
+    // Left and right ear low passes of the sources of every group
+    std::vector<SVFBank<LANES>> svfs_l, svfs_r;
+    int control_left = 0;
+
+    auto set_svf_targets() -> void;
+
+    // Renders `frames` (up to CONTROL_BLOCK) frames of every source, already
+    // written into the delay line, added into `left` and `right`, and
+    // advances the rotations past them
+    auto process_block(float* left, float* right, int frames) -> void;
+};
@@ -1,10 +1,14 @@
 #include "binaural_panner.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <filesystem>
 #include <format>
 #include <numbers>
+#include <stdexcept>
+
+#include "head_model.h"
 
 // BIG BOOK: Spatial Audio by Francis Rumsey
 
@@ -15,144 +19,206 @@ BinauralPanner::BinauralPanner(uint8_t ch_count, uint32_t sample_rate,
       sample_rate(sample_rate),
       woodworth_delay(woodworth_delay),
       apply_svf(apply_svf),
-      rotation_speed(rotation_speed) {}
-
-auto BinauralPanner::_get_simple_delay(float angle_rad, uint32_t sample_rate)
-    -> float {
-    // Calculate ITD based on the sine of the angle
-    float max_delay_samples = 0.00065f * sample_rate;
-    float itd_offset = std::sin(angle_rad) * max_delay_samples;
-
-    return itd_offset;
-}
-
-auto BinauralPanner::_get_woodworth_delay(float relative_angle_rad,
-                                          uint32_t sample_rate) -> float {
-    const float c = 340.0f;   // Speed of sound
-    const float r = 0.0875f;  // Average head radius
-
-    float theta = std::abs(relative_angle_rad);
+      rotation_speed(rotation_speed),
+      delay_line(1, (int)std::ceil(head_model::max_itd_frames(sample_rate)),
+                 CONTROL_BLOCK) {
+    // Rotations by 0..CONTROL_BLOCK frames, in double so every frame of a
+    // block is exact to float precision
+    double step = (double)rotation_speed / sample_rate;
+    for (int i = 0; i <= CONTROL_BLOCK; ++i) {
+        angle_rot_cos[i] = std::cos(i * step);
+        angle_rot_sin[i] = std::sin(i * step);
+        gain_rot_cos[i] = std::cos(0.5 * i * step);
+        gain_rot_sin[i] = std::sin(0.5 * i * step);
+    }
 
-    // Woodworth's Formula
-    float itd_seconds = (r * (theta + std::sin(theta))) / c;
-    return itd_seconds * (float)sample_rate;
+    // ILD angle of curr_angle = 0
+    gain_cos = std::cos(0.25f * std::numbers::pi_v<float>);
+    gain_sin = std::sin(0.25f * std::numbers::pi_v<float>);
 }
 
-// Calculates the delayed "write_index" element using interpolation
-auto BinauralPanner::_read_with_interpolation(float* buf, float delay)
-    -> float {
-    float read_pos = (float)write_index - delay;
-    float wrapped = std::fmod(read_pos, (float)buffer_size);
-
-    if (wrapped < 0) wrapped += buffer_size;
-
-    int i1 = (int)std::floor(wrapped);
-    int i2 = (i1 + 1) % buffer_size;
-    return std::lerp(buf[i1], buf[i2], wrapped - i1);
+BinauralPanner::BinauralPanner(uint8_t ch_count, uint32_t sample_rate,
+                               std::shared_ptr<const HRIRSet> hrirs,
+                               float rotation_speed)
+    : BinauralPanner(ch_count, sample_rate, false, false, rotation_speed) {
+    if (hrirs->get_sample_rate() != (int)sample_rate) {
+        throw std::invalid_argument(std::format(
+            "binaural_rotation: HRIRs at {} Hz, audio at {} Hz",
+            hrirs->get_sample_rate(), sample_rate));
+    }
+    hrtf.emplace(std::move(hrirs));
+    hrtf_input.resize(HRTF_CHUNK);
 }
 
-auto BinauralPanner::_apply_svf(float sin_val, float cos_val,
-                                float& in_out_sample_l, float& in_out_sample_r)
-    -> void {
-    // Calculate a Front-Back factor (0.0 = front, 1.0 = back)
-    float back_factor = std::clamp((1.0f - cos_val) * 0.5f, 0.0f, 1.0f);
-
-    // Calculate Side factors (0.0 = near, 1.0 = far/shadowed)
-    // For Left ear, sin_val = 1 is "far" (right side).
-    float shadow_l = std::clamp(sin_val, 0.0f, 1.0f);
-    // For Right ear, sin_val = -1 is "far" (left side).
-    float shadow_r = std::clamp(-sin_val, 0.0f, 1.0f);
-
-    // Define cutoffs and resonance
-    float normal_cutoff = 0.99f;
-    float shadow_cutoff = 0.35f;
-    float rear_cutoff = 0.20f;
-    float resonance = 0.5;
-
-    // Smoothly interpolate the cutoffs
-    float cutoff_l = std::lerp(normal_cutoff, shadow_cutoff, shadow_l);
-    cutoff_l = std::lerp(cutoff_l, rear_cutoff, back_factor);
-
-    float cutoff_r = std::lerp(normal_cutoff, shadow_cutoff, shadow_r);
-    cutoff_r = std::lerp(cutoff_r, rear_cutoff, back_factor);
-
-    in_out_sample_l = svf_l.process(in_out_sample_l, cutoff_l, resonance,
-                                    PassFilterTypes::low_pass);
-    in_out_sample_r = svf_r.process(in_out_sample_r, cutoff_r, resonance,
-                                    PassFilterTypes::low_pass);
-}
+auto BinauralPanner::_set_svf_targets(float angle_rad) -> void {
+    auto [cutoff_l, cutoff_r] =
+        head_model::shadow_cutoffs(std::cos(angle_rad), std::sin(angle_rad));
 
-auto BinauralPanner::_set_delay_buffers(float input) -> void {
-    delay_buffer_l[write_index] = input;
-    delay_buffer_r[write_index] = input;
+    svfs.set_target(0, cutoff_l, head_model::SHADOW_RESONANCE);
+    svfs.set_target(1, cutoff_r, head_model::SHADOW_RESONANCE);
+    svfs.glide(CONTROL_BLOCK);
 }
 
-auto BinauralPanner::_process(float input, float angle_rad, float& out_l,
-                              float& out_r, float sample_rate,
-                              bool woodworth_delay, bool apply_svf) -> void {
-    float cos_val = std::cos(angle_rad);
-    float sin_val = std::sin(angle_rad);
+auto BinauralPanner::process_block(const float* mono, float* left,
+                                   float* right, int frames) -> void {
+    constexpr float PI = std::numbers::pi_v<float>;
+    float angle_step = rotation_speed / sample_rate;
+
+    alignas(32) std::array<float, CONTROL_BLOCK> delay_l, delay_r, gain_l,
+        gain_r;
+    auto start_angle = (float)curr_angle;
+    const head_model::Itd itd_model(sample_rate, woodworth_delay);
+
+    // First frame of the block whose angle is `past` the turn, with the
+    // loop's arithmetic. The angle is monotonic, at most one frame crosses.
+    auto first_frame = [&](auto past) {
+        if (!past(start_angle + (frames - 1) * angle_step)) return frames;
+        int i = 0;
+        while (!past(start_angle + i * angle_step)) ++i;
+        return i;
+    };
+    int wrap_from = frames, below_from = frames;
+    if (angle_step > 0) {
+        wrap_from = first_frame([&](float a) { return a > 2.0f * PI; });
+    } else {
+        below_from = first_frame([](float a) { return a < 0.0f; });
+    }
 
-    // Get the absolute shortest angle to the median plane (0 is front/back)
-    float azimuth_inc = std::abs(std::atan2(sin_val, std::abs(cos_val)));
+    // Delay and gain trajectories of the block, no branches nor trig. GCC
+    // doesn't if-convert float comparisons (they may trap), so the loop
+    // compares frame indices and uses abs and copysign instead: it
+    // vectorizes from SSE2 on.
+    for (int i = 0; i < frames; ++i) {
+        float sin_val =
+            angle_sin * angle_rot_cos[i] + angle_cos * angle_rot_sin[i];
+
+        // Past 2 pi the angle wraps, and the ILD angle jumps by pi
+        float angle = start_angle + i * angle_step;
+        float wrapped = (float)(i >= wrap_from);
+        angle -= wrapped * (2.0f * PI);
+        angle += (float)(i >= below_from) * (2.0f * PI);
+        float sign = 1.0f - 2.0f * wrapped;
+
+        float itd =
+            itd_model.frames(head_model::fold_to_median(angle), sin_val);
+
+        // The far ear is delayed: the left one when sin_val > 0
+        delay_l[i] = 0.5f * (itd + std::copysign(itd, sin_val));
+        delay_r[i] = itd - delay_l[i];
+
+        gain_l[i] = sign * (gain_cos * gain_rot_cos[i] -
+                            gain_sin * gain_rot_sin[i]);
+        gain_r[i] = sign * (gain_sin * gain_rot_cos[i] +
+                            gain_cos * gain_rot_sin[i]);
+    }
 
-    // Determine hemisphere for Delay assignment
-    bool is_on_right = sin_val > 0;
+    delay_line.write(0, {mono, (size_t)frames});
+    delay_line.read(0, std::span(delay_l).first(frames),
+                    {left, (size_t)frames});
+    delay_line.read(0, std::span(delay_r).first(frames),
+                    {right, (size_t)frames});
+
+    // Head shadow, one frame after the other
+    if (apply_svf) {
+        std::array<float, 2> ears;
+        for (int i = 0; i < frames; ++i) {
+            ears = {left[i], right[i]};
+            svfs.process(ears, ears, PassFilterTypes::low_pass);
+            left[i] = ears[0];
+            right[i] = ears[1];
+        }
+    }
 
-    // Calculate delay in samples
-    float itd_samples;
-    if (woodworth_delay)
-        itd_samples = _get_woodworth_delay(azimuth_inc, sample_rate);
-    else
-        itd_samples = _get_simple_delay(angle_rad, sample_rate);
+    for (int i = 0; i < frames; ++i) {
+        left[i] *= gain_l[i];
+        right[i] *= gain_r[i];
+    }
 
-    float delay_l = is_on_right ? itd_samples : 0.0f;
-    float delay_r = is_on_right ? 0.0f : itd_samples;
+    delay_line.advance(frames);
+
+    // Advance the phasors, renormalized so rounding can't make them drift
+    auto rotate = [](float& c, float& s, float rot_c, float rot_s) {
+        float next_c = c * rot_c - s * rot_s;
+        float next_s = s * rot_c + c * rot_s;
+        float norm = 1.0f / std::sqrt(next_c * next_c + next_s * next_s);
+        c = next_c * norm;
+        s = next_s * norm;
+    };
+    rotate(angle_cos, angle_sin, angle_rot_cos[frames], angle_rot_sin[frames]);
+    rotate(gain_cos, gain_sin, gain_rot_cos[frames], gain_rot_sin[frames]);
+
+    curr_angle += frames * angle_step;
+    if (curr_angle > 2.0f * PI) {
+        curr_angle -= 2.0f * PI;
+        gain_cos = -gain_cos;
+        gain_sin = -gain_sin;
+    }
+    // Only for the trajectories, the ILD angle keeps turning
+    if (curr_angle < 0.0f) curr_angle += 2.0f * PI;
+}
 
-    // Calculate ILD Gains
-    float gain_l =
-        std::cos(angle_rad * 0.5f + (std::numbers::pi_v<float> * 0.25f));
-    float gain_r =
-        std::sin(angle_rad * 0.5f + (std::numbers::pi_v<float> * 0.25f));
+auto BinauralPanner::process_hrtf(ConstAudioView input, AudioView output)
+    -> void {
+    size_t frame_count = input.get_frames();
+    float angle_step = rotation_speed / sample_rate;
 
-    // Set delay buffers
-    _set_delay_buffers(input);
+    for (size_t start = 0; start < frame_count; start += HRTF_CHUNK) {
+        size_t count = std::min(HRTF_CHUNK, frame_count - start);
+        auto left = input.channel(0).subspan(start, count);
+        if (ch_count == 2) {
+            auto right = input.channel(1).subspan(start, count);
+            for (size_t i = 0; i < count; ++i) {
+                hrtf_input[i] = mono_conv.process(left[i], right[i]);
+            }
+        } else {
+            std::copy(left.begin(), left.end(), hrtf_input.begin());
+        }
 
-    // Read samples for left and right
-    out_l = _read_with_interpolation(delay_buffer_l, delay_l);
-    out_r = _read_with_interpolation(delay_buffer_r, delay_r);
+        hrtf->process(std::span(hrtf_input).first(count),
+                      output.channel(0).subspan(start, count),
+                      output.channel(1).subspan(start, count), curr_angle,
+                      angle_step);
 
-    // Apply the svf low pass filter on each side
-    if (apply_svf) _apply_svf(sin_val, cos_val, out_l, out_r);
+        curr_angle += count * angle_step;
+        if (curr_angle > 2.0f * std::numbers::pi_v<float>)
+            curr_angle -= 2.0f * std::numbers::pi_v<float>;
+    }
+}
 
-    // Multiply with gain
-    out_l *= gain_l;
-    out_r *= gain_r;
+auto BinauralPanner::process(ConstAudioView input, AudioView output) -> void {
+    if (hrtf) return process_hrtf(input, output);
 
-    write_index = (write_index + 1) % buffer_size;
-}
+    size_t frame_count = input.get_frames();
+    alignas(32) std::array<float, CONTROL_BLOCK> mono;
 
-auto BinauralPanner::apply(const std::vector<float>& input)
-    -> std::vector<float> {
-    uint32_t frame_count = input.size() / ch_count;
-    std::vector<float> output(frame_count * 2);
+    for (size_t start = 0; start < frame_count;) {
+        if (control_left == 0) {
+            // Cutoffs of the angle reached at the end of the control block
+            if (apply_svf) {
+                _set_svf_targets(curr_angle +
+                                 CONTROL_BLOCK * rotation_speed / sample_rate);
+            }
+            control_left = CONTROL_BLOCK;
+        }
+        int count = std::min<size_t>(control_left, frame_count - start);
+        control_left -= count;
 
-    for (int i = 0; i < frame_count; i++) {
         // Assume monaural audio(convert if needed)
-        float mono_input = input[i];
+        auto first = input.channel(0).subspan(start, count);
         if (ch_count == 2) {
-            mono_input = mono_conv.process(input[2 * i], input[2 * i + 1]);
+            auto second = input.channel(1).subspan(start, count);
+            for (int i = 0; i < count; ++i) {
+                mono[i] = mono_conv.process(first[i], second[i]);
+            }
+        } else {
+            std::copy(first.begin(), first.end(), mono.begin());
         }
 
         // Rotate sound
-        _process(mono_input, curr_angle, output[i * 2], output[i * 2 + 1],
-                 sample_rate, woodworth_delay, apply_svf);
-        curr_angle += (rotation_speed / sample_rate);
-        if (curr_angle > 2.0f * std::numbers::pi_v<float>)
-            curr_angle -= 2.0f * std::numbers::pi_v<float>;
+        process_block(mono.data(), output.channel(0).data() + start,
+                      output.channel(1).data() + start, count);
+        start += count;
     }
-
-    return output;
 }
 
 auto BinauralPanner::get_filter_name() -> std::string {
@@ -163,8 +229,9 @@ auto BinauralPanner::get_output_dir(const std::string& audio_name)
     -> std::string {
     namespace fs = std::filesystem;
     std::string params_str =
-        std::format("{:.2f}_{:.2f}_{:.2f}", rotation_speed,
-                    (float)woodworth_delay, (float)apply_svf);
+        hrtf ? std::format("{:.2f}_hrtf", rotation_speed)
+             : std::format("{:.2f}_{:.2f}_{:.2f}", rotation_speed,
+                           (float)woodworth_delay, (float)apply_svf);
 
     fs::path audio_out_path =
         fs::path(get_filter_name()) / audio_name / params_str;
@@ -1,12 +1,17 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "amp_filter.h"
+#include "delay_line.h"
+#include "hrtf.h"
 #include "stereo_to_mono.cpp"
-#include "svf.h"
+#include "svf_bank.h"
 
 class BinauralPanner : public AMPFilter {
    public:
@@ -14,7 +19,19 @@ class BinauralPanner : public AMPFilter {
                    bool woodworth_delay = true, bool apply_svf = true,
                    float rotation_speed = 0.7);
 
-    auto apply(const std::vector<float>& input) -> std::vector<float> override;
+    // HRTF mode: renders the rotation through `hrirs` instead of the ITD,
+    // ILD and head shadow model. Throws std::invalid_argument if the set was
+    // measured at another sample rate.
+    BinauralPanner(uint8_t ch_count, uint32_t sample_rate,
+                   std::shared_ptr<const HRIRSet> hrirs,
+                   float rotation_speed = 0.7);
+
+    auto process(ConstAudioView input, AudioView output) -> void override;
+    auto get_in_channels() -> int override { return ch_count; }
+    auto get_out_channels() -> int override { return 2; }
+    auto get_latency() -> int override {
+        return hrtf ? hrtf->get_latency() : 0;
+    }
     auto get_output_dir(const std::string& audio_name) -> std::string override;
     auto get_filter_name() -> std::string override;
 
@@ -23,23 +40,40 @@ class BinauralPanner : public AMPFilter {
     float rotation_speed;
     uint8_t ch_count;
     uint32_t sample_rate;
-    float curr_angle = 0;
+    // Summed in double, a float drifts from the rotation speed
+    double curr_angle = 0;
+
+    // Head shadow low pass, lane 0 is the left ear. Its cutoffs follow the
+    // rotation once per control block.
+    static constexpr int CONTROL_BLOCK = 32;
+    int control_left = 0;
+    SVFBank<2> svfs;
 
-    static const int buffer_size = 4410;
-    float delay_buffer_l[buffer_size] = {}, delay_buffer_r[buffer_size] = {};
-    int write_index = 0;
-    SVF svf_l, svf_r;
+    // The rotation as phasors: (cos, sin) of curr_angle and of the ILD angle
+    // curr_angle / 2 + pi / 4. They are advanced once per block by a
+    // precomputed rotation and renormalized, every frame of a block is
+    // rotated from its start by rotations[frame].
+    float angle_cos = 1.0f, angle_sin = 0.0f;
+    float gain_cos, gain_sin;
+    alignas(32) std::array<float, CONTROL_BLOCK + 1> angle_rot_cos,
+        angle_rot_sin, gain_rot_cos, gain_rot_sin;
+
+    // Input history of both ears, up to the largest ITD
+    DelayLine<LinearInterp> delay_line;
 
     StereoToMono mono_conv;
 
-    auto _get_simple_delay(float angle_rad, uint32_t sample_rate) -> float;
-    auto _get_woodworth_delay(float relative_angle_rad, uint32_t sample_rate)
-        -> float;
-    auto _read_with_interpolation(float* buf, float delay) -> float;
-    void _apply_svf(float sin_val, float cos_val, float& in_out_sample_l,
-                    float& in_out_sample_r);
-    void _set_delay_buffers(float input);
-    void _process(float input, float angle_rad, float& out_l, float& out_r,
-                  float sample_rate, bool woodworth_delay = true,
-                  bool apply_svf = true);
+    // HRTF mode only, with the mono input of up to HRTF_CHUNK frames
+    static constexpr size_t HRTF_CHUNK = 256;
+    std::optional<HRTFRenderer> hrtf;
+    std::vector<float> hrtf_input;
+
+    auto process_hrtf(ConstAudioView input, AudioView output) -> void;
+
+    void _set_svf_targets(float angle_rad);
+
+    // Renders `frames` (up to CONTROL_BLOCK) frames of `mono` into `left`
+    // and `right`, and advances the rotation past them
+    auto process_block(const float* mono, float* left, float* right,
+                       int frames) -> void;
 };
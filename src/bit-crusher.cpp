@@ -1,43 +1,32 @@
 #include "bit-crusher.h"
+#include <algorithm>
+#include <array>
 #include <cmath>
 #include <numbers>
 #include <filesystem>
 #include <format>
 
-float Bitcrusher::_process(float input, uint8_t bits, float downsample) {
-    sample_counter += 1.0f;
-    float wet = 0.5;
-    
-    // Only update the 'last_sample' when the counter hits the threshold
-    if (sample_counter >= downsample) {
-        // Calculate how many discrete levels we have (e.g., 8-bit = 256 levels)
-        float levels = std::pow(2.0f, bits);
-        
-        // Crush signal
-        last_sample = std::round(input * levels) / levels;
-        
-        // Reset counter (accounting for fractional downsample values)
-        sample_counter -= downsample;
-    }
+auto BitcrusherFilter::process(ConstAudioView input, AudioView output)
+    -> void {
+    size_t frame_count = input.get_frames();
+    alignas(32) std::array<float, LANES> in = {}, crushed;
 
-    return std::lerp(input, last_sample, wet);
-}
+    for (size_t bank = 0; bank < banks.size(); ++bank) {
+        int first = bank * LANES;
+        int count = std::min<int>(LANES, ch_count - first);
+
+        for (size_t i = 0; i < frame_count; ++i) {
+            for (int lane = 0; lane < count; ++lane) {
+                in[lane] = input.channel(first + lane)[i];
+            }
 
-auto BitcrusherFilter::apply(const std::vector<float>& input)
-    -> std::vector<float> {
-    uint32_t frame_count = input.size() / ch_count;
-    std::vector<float> output(input.size());
-    
-    for (int i = 0; i < frame_count; ++i) {
-        if (ch_count == 2) {
-            output[2 * i] = bc_left._process(input[2 * i], max_bits, max_downsample);
-            output[2 * i + 1] = bc_right._process(input[2 * i + 1], max_bits, max_downsample);
-        } else {
-            output[i] = bc_left._process(input[2 * i], max_bits, max_downsample);
+            banks[bank].process(in, crushed, levels, max_downsample);
+
+            for (int lane = 0; lane < count; ++lane) {
+                output.channel(first + lane)[i] = crushed[lane];
+            }
         }
     }
-
-    return output;
 }
 
 auto BitcrusherFilter::get_filter_name() -> std::string {
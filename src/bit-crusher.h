@@ -1,26 +1,69 @@
-#include <vector>
+#pragma once
+
+#include <array>
+#include <cmath>
 #include <cstdint>
+#include <span>
 #include <string>
+#include <vector>
 #include "amp_filter.h"
 
-class Bitcrusher{
-private:
-    float last_sample = 0.0f;
-    float sample_counter = 0.0f;
+// N bitcrushers (one per channel) running in lock-step, the state of the
+// lanes stored as arrays so the lane loop compiles to SIMD instructions.
+// Rounding vectorizes from SSE4.1 on (see AMP_NATIVE_ARCH).
+template <size_t N>
+class BitcrusherBank {
 public:
-    auto _process(float input, uint8_t bits, float downsample) -> float;
+    static constexpr size_t lanes = N;
+
+    // levels: 2^bits quantization steps, downsample: frames a crushed sample
+    // is held for (may be fractional)
+    auto process(std::span<const float, N> input, std::span<float, N> output,
+                 float levels, float downsample) -> void {
+        constexpr float wet = 0.5f;
+        for (size_t lane = 0; lane < N; ++lane) {
+            float counter = sample_counter[lane] + 1.0f;
+            // 1 once the counter hits the threshold, from the sign of the
+            // difference: GCC does not vectorize float comparisons
+            float take =
+                0.5f + 0.5f * std::copysign(1.0f, counter - downsample);
+
+            // Only update the last sample when the counter hits the threshold
+            float crushed = std::nearbyint(input[lane] * levels) / levels;
+            last_sample[lane] =
+                take * crushed + (1.0f - take) * last_sample[lane];
+
+            // Reset counter (accounting for fractional downsample values)
+            sample_counter[lane] = counter - take * downsample;
+
+            output[lane] =
+                input[lane] + wet * (last_sample[lane] - input[lane]);
+        }
+    }
+
+private:
+    alignas(32) std::array<float, N> last_sample{}, sample_counter{};
 };
 
 class BitcrusherFilter : public AMPFilter{
 private:
+    // Channels per bank, one SSE register
+    static constexpr size_t LANES = 4;
+
     uint8_t ch_count, max_bits, curr_bits;
     float max_downsample;
-    Bitcrusher bc_left, bc_right;
+    float levels;
+
+    // Channel c is lane c % LANES of banks[c / LANES]
+    std::vector<BitcrusherBank<LANES>> banks;
 public:
     BitcrusherFilter(uint8_t ch_count, uint8_t max_bits = 8, float max_downsample = 8.0f)
-        : ch_count(ch_count), max_bits(max_bits), max_downsample(max_downsample){}
+        : ch_count(ch_count), max_bits(max_bits), max_downsample(max_downsample),
+          levels(std::pow(2.0f, max_bits)),
+          banks((ch_count + LANES - 1) / LANES) {}
 
-    auto apply(const std::vector<float>& input) -> std::vector<float> override;
+    auto process(ConstAudioView input, AudioView output) -> void override;
+    auto get_in_channels() -> int override { return ch_count; }
     auto get_output_dir(const std::string& audio_name) -> std::string override;
     auto get_filter_name() -> std::string override;
-};
\ No newline at end of file
+};
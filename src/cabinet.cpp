@@ -1,14 +1,15 @@
 #include "cabinet.h"
 
 #include <algorithm>
+#include <cmath>
 #include <filesystem>
 #include <stdexcept>
 
 #include "audio_handler.h"
-#include "fft.h"
 
-CabinetConvolver::CabinetConvolver(const std::string& ir_path, int block_size)
-    : block_size(block_size) {
+CabinetIR::CabinetIR(const std::string& ir_path, int partition_size,
+                     ConvolutionMode mode)
+    : partition_size(partition_size), mode(mode) {
     AudioFileHandler ir_handler;
     if (!ir_handler.open_read(ir_path)) {
         throw std::runtime_error("CabinetConvolver: Failed to load IR: " +
@@ -31,20 +32,16 @@ CabinetConvolver::CabinetConvolver(const std::string& ir_path, int block_size)
 
     size_t num_frames = ir_raw_interleaved.size() / num_channels;
 
-    size_t required_size = block_size + num_frames - 1;
-    this->fft_size = 1;
-    while (this->fft_size < required_size) this->fft_size *= 2;
-
-    std::vector<Complex> ir_padded_L(this->fft_size, {0, 0});
-    std::vector<Complex> ir_padded_R(this->fft_size, {0, 0});
+    std::vector<float> ir_L(num_frames, 0.0f);
+    std::vector<float> ir_R(num_frames, 0.0f);
 
     for (size_t i = 0; i < num_frames; ++i) {
         if (num_channels == 1) {
-            ir_padded_L[i] = ir_raw_interleaved[i];
-            ir_padded_R[i] = ir_raw_interleaved[i];
+            ir_L[i] = ir_raw_interleaved[i];
+            ir_R[i] = ir_raw_interleaved[i];
         } else if (num_channels >= 2) {
-            ir_padded_L[i] = ir_raw_interleaved[i * num_channels + 0];
-            ir_padded_R[i] = ir_raw_interleaved[i * num_channels + 1];
+            ir_L[i] = ir_raw_interleaved[i * num_channels + 0];
+            ir_R[i] = ir_raw_interleaved[i * num_channels + 1];
         }
     }
 
@@ -54,101 +51,63 @@ CabinetConvolver::CabinetConvolver(const std::string& ir_path, int block_size)
 
         size_t idx = num_frames - 1 - k;
 
-        ir_padded_L[idx] *= gain;
-        ir_padded_R[idx] *= gain;
+        ir_L[idx] *= gain;
+        ir_R[idx] *= gain;
     }
 
     float max_peak = 0.0f;
     for (size_t i = 0; i < num_frames; ++i) {
-        max_peak = std::max(max_peak, std::abs(ir_padded_L[i].real()));
-        max_peak = std::max(max_peak, std::abs(ir_padded_R[i].real()));
+        max_peak = std::max(max_peak, std::abs(ir_L[i]));
+        max_peak = std::max(max_peak, std::abs(ir_R[i]));
     }
 
     if (max_peak > 0.00001f) {
         float scale_factor = 0.5f / max_peak;
 
         for (size_t i = 0; i < num_frames; ++i) {
-            ir_padded_L[i] *= scale_factor;
-            ir_padded_R[i] *= scale_factor;
+            ir_L[i] *= scale_factor;
+            ir_R[i] *= scale_factor;
         }
     }
 
-    this->ir_fft_l = FFT::compute(ir_padded_L, FFT_DIR::forward);
-    this->ir_fft_r = FFT::compute(ir_padded_R, FFT_DIR::forward);
-
-    this->tail_l.assign(this->fft_size, 0.0f);
-    this->tail_r.assign(this->fft_size, 0.0f);
+    for (const auto* ir : {&ir_L, &ir_R}) {
+        if (mode == ConvolutionMode::non_uniform) {
+            this->non_uniform.push_back(
+                std::make_shared<NonUniformIR>(*ir, partition_size));
+        } else {
+            this->uniform.push_back(
+                std::make_shared<IRPartitions>(*ir, partition_size));
+        }
+    }
 }
 
-auto CabinetConvolver::apply(const std::vector<float>& input)
-    -> std::vector<float> {
-    if (input.size() > this->block_size * 2) {
-        throw std::runtime_error("Input chunk too large.");
+auto CabinetIR::make_convolver(int channel) const
+    -> std::unique_ptr<Convolver> {
+    if (mode == ConvolutionMode::non_uniform) {
+        return std::make_unique<NonUniformConvolver>(non_uniform[channel]);
     }
+    return std::make_unique<PartitionedConvolver>(uniform[channel]);
+}
 
-    size_t num_frames = input.size() / 2;
-
-    std::vector<Complex> input_L(this->fft_size, {0, 0});
-    std::vector<Complex> input_R(this->fft_size, {0, 0});
+CabinetConvolver::CabinetConvolver(const std::string& ir_path,
+                                   int partition_size, ConvolutionMode mode)
+    : CabinetConvolver(
+          std::make_shared<CabinetIR>(ir_path, partition_size, mode)) {}
 
-    for (size_t i = 0; i < num_frames; ++i) {
-        input_L[i] = {input[2 * i], 0.0f};
-        input_R[i] = {input[2 * i + 1], 0.0f};
+CabinetConvolver::CabinetConvolver(std::shared_ptr<const CabinetIR> ir)
+    : ir(std::move(ir)) {
+    for (int ch = 0; ch < get_in_channels(); ++ch) {
+        this->convolvers.push_back(this->ir->make_convolver(ch));
     }
+}
 
-    std::vector<Complex> fft_in_L = FFT::compute(input_L, FFT_DIR::forward);
-    std::vector<Complex> fft_in_R = FFT::compute(input_R, FFT_DIR::forward);
-
-    auto process_channel =
-        [&](const std::vector<Complex>& signal_fft,
-            const std::vector<Complex>& ir_fft,
-            std::vector<float>& tail_buffer) -> std::vector<float> {
-        std::vector<Complex> spectrum(this->fft_size);
-        for (size_t k = 0; k < this->fft_size; ++k) {
-            spectrum[k] = signal_fft[k] * ir_fft[k];
-        }
-
-        std::vector<Complex> time_domain =
-            FFT::compute(spectrum, FFT_DIR::backward);
-
-        std::vector<float> output_channel;
-        output_channel.reserve(num_frames);
-
-        for (size_t k = 0; k < num_frames; ++k) {
-            float sample = time_domain[k].real() / (float)this->fft_size;
-            sample += tail_buffer[k];
-            output_channel.push_back(sample);
-        }
-
-        size_t remaining_tail = this->fft_size - num_frames;
-        for (size_t k = 0; k < remaining_tail; ++k) {
-            tail_buffer[k] = tail_buffer[k + num_frames];
-        }
-        std::fill(tail_buffer.begin() + remaining_tail, tail_buffer.end(),
-                  0.0f);
-
-        for (size_t k = num_frames; k < this->fft_size; ++k) {
-            float val = time_domain[k].real() / (float)this->fft_size;
-            tail_buffer[k - num_frames] += val;  // Accumulate!
-        }
-
-        return output_channel;
-    };
-
-    std::vector<float> out_L =
-        process_channel(fft_in_L, this->ir_fft_l, this->tail_l);
-    std::vector<float> out_R =
-        process_channel(fft_in_R, this->ir_fft_r, this->tail_r);
-
-    std::vector<float> stereo_output;
-    stereo_output.reserve(input.size());
-
-    for (size_t i = 0; i < num_frames; ++i) {
-        stereo_output.push_back(out_L[i]);
-        stereo_output.push_back(out_R[i]);
+auto CabinetConvolver::process(ConstAudioView input, AudioView output)
+    -> void {
+    // The channels are already contiguous, the convolvers take them as they
+    // are (in place too)
+    for (size_t ch = 0; ch < convolvers.size(); ++ch) {
+        convolvers[ch]->process(input.channel(ch), output.channel(ch));
     }
-
-    return stereo_output;
 }
 
 auto CabinetConvolver::get_filter_name() -> std::string {
@@ -1,24 +1,56 @@
 #pragma once
 
-#include <complex>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "amp_filter.h"
+#include "convolver.h"
 
-using Complex = std::complex<float>;
+enum class ConvolutionMode {
+    // Uniformly partitioned, cost grows linearly with the IR length
+    uniform = 0,
+    // Gardner style, partition_size is the size of the head partitions
+    non_uniform = 1
+};
+
+// The cabinet IR, loaded, normalized and partitioned once per channel.
+// Immutable, so it can be shared by any number of CabinetConvolvers.
+class CabinetIR {
+   public:
+    // partition_size: length of the (first) IR partitions. The cost of a
+    // partition grows with it, the cost per second of IR shrinks. Any block
+    // size can be processed regardless of it.
+    CabinetIR(const std::string& ir_path, int partition_size = 256,
+              ConvolutionMode mode = ConvolutionMode::uniform);
+
+    // A new convolver (with its own state) for the left (0) or right (1) IR
+    auto make_convolver(int channel) const -> std::unique_ptr<Convolver>;
+
+    auto get_partition_size() const -> int { return partition_size; }
+
+   private:
+    int partition_size;
+    ConvolutionMode mode;
+
+    // Per channel, depending on the mode
+    std::vector<std::shared_ptr<const IRPartitions>> uniform;
+    std::vector<std::shared_ptr<const NonUniformIR>> non_uniform;
+};
 
 class CabinetConvolver : public AMPFilter {
    public:
-    CabinetConvolver(const std::string& ir_path, int block_size);
-    auto apply(const std::vector<float>& input) -> std::vector<float> override;
+    CabinetConvolver(const std::string& ir_path, int partition_size = 256,
+                     ConvolutionMode mode = ConvolutionMode::uniform);
+    explicit CabinetConvolver(std::shared_ptr<const CabinetIR> ir);
+    auto process(ConstAudioView input, AudioView output) -> void override;
+    auto get_in_channels() -> int override { return 2; }
     auto get_output_dir(const std::string& audio_name) -> std::string override;
     auto get_filter_name() -> std::string override;
 
    private:
-    int block_size;
-    int fft_size;
+    std::shared_ptr<const CabinetIR> ir;
 
-    std::vector<Complex> ir_fft_l, ir_fft_r;
-    std::vector<float> tail_l, tail_r;
+    // One per channel (left, right)
+    std::vector<std::unique_ptr<Convolver>> convolvers;
 };
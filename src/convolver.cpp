@@ -0,0 +1,275 @@
+#include "convolver.h"
+
+#include <algorithm>
+
+IRPartitions::IRPartitions(std::span<const float> ir, int partition_size)
+    : partition_size(partition_size) {
+    partition_count = std::max<int>(
+        1, (ir.size() + partition_size - 1) / partition_size);
+    spectra.resize(partition_count * get_bins());
+
+    FFT fft(2 * partition_size);
+    float scale = 1.0f / (float)fft.get_size();
+
+    for (int p = 0; p < partition_count; ++p) {
+        size_t offset = (size_t)p * partition_size;
+        size_t count = std::min<size_t>(partition_size, ir.size() - offset);
+
+        std::span<std::complex<float>> dst(spectra.data() + p * get_bins(),
+                                           get_bins());
+        fft.forward(ir.subspan(offset, count), dst);
+
+        for (auto& bin : dst) bin *= scale;
+    }
+}
+
+auto IRPartitions::get_spectrum(int partition) const
+    -> std::span<const std::complex<float>> {
+    return {spectra.data() + partition * get_bins(), (size_t)get_bins()};
+}
+
+PartitionedConvolver::PartitionedConvolver(
+    std::shared_ptr<const IRPartitions> ir)
+    : ir(std::move(ir)),
+      partition_size(this->ir->get_partition_size()),
+      partition_count(this->ir->get_partition_count()),
+      fft(2 * partition_size) {
+    window.resize(2 * partition_size);
+    fdl.resize(partition_count * this->ir->get_bins());
+    tail_spectrum.resize(this->ir->get_bins());
+    reset();
+}
+
+auto PartitionedConvolver::reset() -> void {
+    std::fill(window.begin(), window.end(), 0.0f);
+    std::fill(fdl.begin(), fdl.end(), std::complex<float>{0, 0});
+    std::fill(tail_spectrum.begin(), tail_spectrum.end(),
+              std::complex<float>{0, 0});
+    fill = 0;
+    fdl_pos = 0;
+}
+
+auto PartitionedConvolver::process(std::span<const float> input,
+                                   std::span<float> output) -> void {
+    const int bins = ir->get_bins();
+    size_t done = 0;
+
+    while (done < input.size()) {
+        size_t count =
+            std::min<size_t>(input.size() - done, partition_size - fill);
+
+        // A new partition starts: everything but the newest IR partition only
+        // depends on complete windows, so it is summed once per partition.
+        if (fill == 0) {
+            std::fill(tail_spectrum.begin(), tail_spectrum.end(),
+                      std::complex<float>{0, 0});
+
+            for (int p = 1; p < partition_count; ++p) {
+                int slot = (fdl_pos + p) % partition_count;
+                const std::complex<float>* x = fdl.data() + slot * bins;
+                const std::complex<float>* h = ir->get_spectrum(p).data();
+
+                for (int k = 0; k < bins; ++k) {
+                    tail_spectrum[k] += x[k] * h[k];
+                }
+            }
+        }
+
+        std::copy_n(input.begin() + done, count,
+                    window.begin() + partition_size + fill);
+
+        std::copy(window.begin(), window.end(), fft.real().begin());
+        fft.forward();
+
+        auto spectrum = fft.spectrum();
+        bool block_done = fill + (int)count == partition_size;
+        if (block_done) {
+            // The complete window becomes the newest FDL entry
+            std::copy(spectrum.begin(), spectrum.end(),
+                      fdl.begin() + fdl_pos * bins);
+        }
+
+        const std::complex<float>* h0 = ir->get_spectrum(0).data();
+        for (int k = 0; k < bins; ++k) {
+            spectrum[k] = spectrum[k] * h0[k] + tail_spectrum[k];
+        }
+
+        fft.inverse();
+
+        // Overlap-save: only the second half is free of circular wrap around
+        auto time_domain = fft.real();
+        std::copy_n(time_domain.begin() + partition_size + fill, count,
+                    output.begin() + done);
+
+        fill += count;
+        done += count;
+
+        if (block_done) {
+            std::copy(window.begin() + partition_size, window.end(),
+                      window.begin());
+            std::fill(window.begin() + partition_size, window.end(), 0.0f);
+
+            fill = 0;
+            fdl_pos = (fdl_pos + partition_count - 1) % partition_count;
+        }
+    }
+}
+
+NonUniformIR::NonUniformIR(std::span<const float> ir, int head_size,
+                           int max_partition) {
+    size_t offset = std::min<size_t>(ir.size(), 4 * head_size);
+    head = std::make_shared<IRPartitions>(ir.first(offset), head_size);
+
+    for (size_t size = 2 * head_size; offset < ir.size(); size *= 2) {
+        size_t count = size >= (size_t)max_partition
+                           ? ir.size() - offset
+                           : std::min(2 * size, ir.size() - offset);
+
+        segments.push_back(
+            std::make_shared<IRPartitions>(ir.subspan(offset, count), size));
+        offset += count;
+    }
+}
+
+NonUniformConvolver::Segment::Segment(std::shared_ptr<const IRPartitions> ir,
+                                      int phase)
+    : ir(std::move(ir)),
+      partition_size(this->ir->get_partition_size()),
+      partition_count(this->ir->get_partition_count()),
+      phase(phase),
+      fft(2 * partition_size),
+      work_units(partition_count + 2) {
+    window.resize(2 * partition_size);
+    incoming.resize(partition_size);
+    fdl.resize(partition_count * this->ir->get_bins());
+    accumulator.resize(this->ir->get_bins());
+    output_ready.resize(partition_size);
+    output_next.resize(partition_size);
+    reset();
+}
+
+auto NonUniformConvolver::Segment::reset() -> void {
+    std::fill(window.begin(), window.end(), 0.0f);
+    std::fill(incoming.begin(), incoming.end(), 0.0f);
+    std::fill(fdl.begin(), fdl.end(), std::complex<float>{0, 0});
+    std::fill(accumulator.begin(), accumulator.end(),
+              std::complex<float>{0, 0});
+    std::fill(output_ready.begin(), output_ready.end(), 0.0f);
+    std::fill(output_next.begin(), output_next.end(), 0.0f);
+    fill = 0;
+    fdl_pos = 0;
+    work_done = 0;
+}
+
+auto NonUniformConvolver::Segment::run_work(int fill) -> void {
+    // Units are spread linearly over [phase, partition_size)
+    int due = 0;
+    if (fill > phase) {
+        due = (work_units * (fill - phase) + (partition_size - phase) - 1) /
+              (partition_size - phase);
+    }
+
+    const int bins = ir->get_bins();
+    for (; work_done < std::min(due, work_units); ++work_done) {
+        if (work_done == 0) {
+            std::copy(window.begin(), window.end(), fft.real().begin());
+            fft.forward();
+
+            auto spectrum = fft.spectrum();
+            std::copy(spectrum.begin(), spectrum.end(),
+                      fdl.begin() + fdl_pos * bins);
+            std::fill(accumulator.begin(), accumulator.end(),
+                      std::complex<float>{0, 0});
+        } else if (work_done <= partition_count) {
+            int p = work_done - 1;
+            int slot = (fdl_pos + p) % partition_count;
+            const std::complex<float>* x = fdl.data() + slot * bins;
+            const std::complex<float>* h = ir->get_spectrum(p).data();
+
+            for (int k = 0; k < bins; ++k) {
+                accumulator[k] += x[k] * h[k];
+            }
+        } else {
+            auto spectrum = fft.spectrum();
+            std::copy(accumulator.begin(), accumulator.end(),
+                      spectrum.begin());
+            fft.inverse();
+
+            auto time_domain = fft.real();
+            std::copy(time_domain.begin() + partition_size, time_domain.end(),
+                      output_next.begin());
+
+            fdl_pos = (fdl_pos + partition_count - 1) % partition_count;
+        }
+    }
+}
+
+auto NonUniformConvolver::Segment::process(std::span<const float> input,
+                                           std::span<float> output) -> void {
+    size_t done = 0;
+
+    while (done < input.size()) {
+        size_t count =
+            std::min<size_t>(input.size() - done, partition_size - fill);
+
+        std::copy_n(input.begin() + done, count, incoming.begin() + fill);
+        for (size_t i = 0; i < count; ++i) {
+            output[done + i] += output_ready[fill + i];
+        }
+
+        fill += count;
+        done += count;
+        run_work(fill);
+
+        if (fill == partition_size) {
+            // The work on the last window is complete, its result is played
+            // during the next block
+            std::swap(output_ready, output_next);
+
+            std::copy(window.begin() + partition_size, window.end(),
+                      window.begin());
+            std::copy(incoming.begin(), incoming.end(),
+                      window.begin() + partition_size);
+
+            fill = 0;
+            work_done = 0;
+        }
+    }
+}
+
+NonUniformConvolver::NonUniformConvolver(
+    std::shared_ptr<const NonUniformIR> ir)
+    : ir(std::move(ir)), head(this->ir->get_head()) {
+    const int head_size = this->ir->get_head()->get_partition_size();
+
+    // Segment k starts its work k - 1 head blocks into its period (up to a
+    // quarter of it), so FFTs of different sizes land in different blocks
+    int k = 0;
+    for (const auto& segment : this->ir->get_segments()) {
+        int phase =
+            std::min(k * head_size, segment->get_partition_size() / 4);
+        segments.emplace_back(segment, phase);
+        ++k;
+    }
+
+    scratch.resize(head_size);
+}
+
+auto NonUniformConvolver::reset() -> void {
+    head.reset();
+    for (auto& segment : segments) segment.reset();
+}
+
+auto NonUniformConvolver::process(std::span<const float> input,
+                                  std::span<float> output) -> void {
+    for (size_t start = 0; start < input.size(); start += scratch.size()) {
+        size_t count = std::min(scratch.size(), input.size() - start);
+        auto in = input.subspan(start, count);
+        std::span<float> out(scratch.data(), count);
+
+        head.process(in, out);
+        for (auto& segment : segments) segment.process(in, out);
+
+        std::copy(out.begin(), out.end(), output.begin() + start);
+    }
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <complex>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "fft.h"
+
+// An impulse response split into partitions of `partition_size` samples.
+// Every partition is stored as the spectrum of the partition zero padded to
+// 2 * partition_size, already scaled by the inverse FFT normalization.
+// It is immutable once built, so several convolvers can share one instance.
+class IRPartitions {
+   public:
+    IRPartitions(std::span<const float> ir, int partition_size);
+
+    auto get_partition_size() const -> int { return partition_size; }
+    auto get_partition_count() const -> int { return partition_count; }
+    auto get_bins() const -> int { return partition_size + 1; }
+
+    auto get_spectrum(int partition) const
+        -> std::span<const std::complex<float>>;
+
+   private:
+    int partition_size;
+    int partition_count;
+    std::vector<std::complex<float>> spectra;
+};
+
+// Single channel convolution engine
+class Convolver {
+   public:
+    virtual ~Convolver() = default;
+
+    // `input` and `output` have the same size and may be the same buffer
+    virtual auto process(std::span<const float> input, std::span<float> output)
+        -> void = 0;
+
+    virtual auto reset() -> void = 0;
+};
+
+// Uniformly partitioned overlap-save convolution of a single channel.
+//
+// Every FFT covers the previous and the current partition of input
+// (2 * partition_size samples). The spectra of past input windows are kept in
+// a frequency-domain delay line (FDL), so a new block only costs one
+// forward/inverse FFT pair plus one complex multiply-accumulate per
+// partition, independent of the IR length.
+//
+// process() accepts any amount of samples and has no latency: a partially
+// filled partition is convolved with the first IR partition right away, while
+// the contribution of the older partitions is accumulated once per partition.
+class PartitionedConvolver : public Convolver {
+   public:
+    explicit PartitionedConvolver(std::shared_ptr<const IRPartitions> ir);
+
+    auto process(std::span<const float> input, std::span<float> output)
+        -> void override;
+
+    auto reset() -> void override;
+
+   private:
+    std::shared_ptr<const IRPartitions> ir;
+    int partition_size;
+    int partition_count;
+
+    FFT fft;
+
+    // [previous partition | current partition], zero after `fill`
+    std::vector<float> window;
+    int fill = 0;
+
+    // Spectra of the last `partition_count` complete windows, used as a ring
+    std::vector<std::complex<float>> fdl;
+    int fdl_pos = 0;
+
+    // Sum of the FDL * IR products of partitions 1.., fixed for a whole block
+    std::vector<std::complex<float>> tail_spectrum;
+};
+
+// IR layout for NonUniformConvolver (Gardner 1995): a head split into
+// `head_size` partitions covering the first 4 * head_size samples, followed by
+// segments whose partition size doubles every time. A segment with partition
+// size N starts at IR offset 2 * N and holds two partitions, except for the
+// last one (partition size `max_partition`) which holds the rest of the IR.
+class NonUniformIR {
+   public:
+    NonUniformIR(std::span<const float> ir, int head_size = 64,
+                 int max_partition = 8192);
+
+    auto get_head() const -> const std::shared_ptr<const IRPartitions>& {
+        return head;
+    }
+    auto get_segments() const
+        -> const std::vector<std::shared_ptr<const IRPartitions>>& {
+        return segments;
+    }
+
+   private:
+    std::shared_ptr<const IRPartitions> head;
+    std::vector<std::shared_ptr<const IRPartitions>> segments;
+};
+
+// Zero latency non-uniform partitioned convolution of a single channel.
+//
+// The head of the IR runs through a PartitionedConvolver with small
+// partitions, so it has no input/output delay. Each following segment is
+// convolved block-wise with its larger partition size N: since it starts 2 * N
+// samples into the IR, the result of an input block is only needed one block
+// after the block is complete. The FFTs and multiply-accumulates for it are
+// therefore spread evenly over the N samples of the next block, and every
+// segment is shifted by a different phase, so large partitions never produce
+// periodic CPU spikes.
+class NonUniformConvolver : public Convolver {
+   public:
+    explicit NonUniformConvolver(std::shared_ptr<const NonUniformIR> ir);
+
+    auto process(std::span<const float> input, std::span<float> output)
+        -> void override;
+
+    auto reset() -> void override;
+
+   private:
+    // Convolves one segment, with 2 blocks of delay
+    class Segment {
+       public:
+        Segment(std::shared_ptr<const IRPartitions> ir, int phase);
+
+        // Consumes `input` and adds the segment's output to `output`
+        auto process(std::span<const float> input, std::span<float> output)
+            -> void;
+
+        auto reset() -> void;
+
+       private:
+        // Runs the work units due after `fill` samples of the current block
+        auto run_work(int fill) -> void;
+
+        std::shared_ptr<const IRPartitions> ir;
+        int partition_size;
+        int partition_count;
+
+        // Samples of the block period before the work starts
+        int phase;
+
+        FFT fft;
+
+        // [previous block | last complete block], frozen during one block
+        std::vector<float> window;
+        // Block currently being received
+        std::vector<float> incoming;
+        int fill = 0;
+
+        std::vector<std::complex<float>> fdl;
+        int fdl_pos = 0;
+        std::vector<std::complex<float>> accumulator;
+
+        // Forward FFT, one multiply-accumulate per partition, inverse FFT
+        int work_units;
+        int work_done = 0;
+
+        // Output played during the current block / computed for the next one
+        std::vector<float> output_ready, output_next;
+    };
+
+    std::shared_ptr<const NonUniformIR> ir;
+    PartitionedConvolver head;
+    std::vector<Segment> segments;
+
+    // Head output, so `input` stays readable for the segments
+    std::vector<float> scratch;
+};
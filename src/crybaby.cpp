@@ -1,5 +1,7 @@
 #include "crybaby.h"
 
+#include <algorithm>
+#include <array>
 #include <cmath>
 #include <filesystem>
 #include <format>
@@ -17,49 +19,68 @@ auto CrybabyEffect::get_resonance_sweep(float sweep) -> float {
     return std::min(0.99f, resonance_start + (resonance_factor * sweep));
 }
 
-auto CrybabyEffect::get_cutoff(EnvelopeFollower& env_fol, float input,
-                               float sweep) -> float {
-    if (use_env_fol)
-        return env_fol.process(input);
-    else
-        return get_cutoff_sweep_exp(sweep);
-}
+auto CrybabyEffect::update_control() -> void {
+    // Sweep at the end of the control block, where the glide lands
+    sweep += CONTROL_BLOCK * sweep_speed_hz / sample_rate;
+    if (sweep > 1.0f) sweep -= 1.0f;
+
+    // Convert sweep to a triangle wave (0.0 to 1.0 and back)
+    float tri_sweep = get_tri_sweep(sweep);
 
-auto CrybabyEffect::_process(SVF& svf, EnvelopeFollower& env_fol, float input,
-                             float tri_sweep, float resonance_sweep) -> float {
-    float cutoff = get_cutoff(env_fol, input, tri_sweep);
-    float result =
-        svf.process(input, cutoff, resonance_sweep, PassFilterTypes::band_pass);
-    return std::lerp(input, result, 0.8f);
+    // Sweep cutoff and resonance
+    float resonance_sweep = get_resonance_sweep(tri_sweep);
+    float cutoff_sweep = get_cutoff_sweep_exp(tri_sweep);
+
+    for (int c = 0; c < ch_count; ++c) {
+        float cutoff = use_env_fol ? envelopes[c] : cutoff_sweep;
+        svfs[c / LANES].set_target(c % LANES, cutoff, resonance_sweep);
+    }
+    for (auto& bank : svfs) bank.glide(CONTROL_BLOCK);
 }
 
-auto CrybabyEffect::apply(const std::vector<float>& input)
-    -> std::vector<float> {
-    uint32_t frame_count = input.size() / ch_count;
-    std::vector<float> output(input.size());
-    for (int i = 0; i < frame_count; ++i) {
-        // Update sweep
-        sweep += sweep_speed_hz / sample_rate;
-        if (sweep > 1.0f) sweep -= 1.0f;
-
-        // Convert sweep to a triangle wave (0.0 to 1.0 and back)
-        float tri_sweep = get_tri_sweep(sweep);
-
-        // Sweep cutoff and resonance
-        float resonance_sweep = get_resonance_sweep(tri_sweep);
-
-        if (ch_count == 2) {
-            output[2 * i] = _process(svf_left, env_fol_l, input[2 * i],
-                                     tri_sweep, resonance_sweep);
-            output[2 * i + 1] = _process(svf_right, env_fol_r, input[2 * i + 1],
-                                         tri_sweep, resonance_sweep);
-        } else {
-            output[i] = _process(svf_left, env_fol_l, input[i], tri_sweep,
-                                 resonance_sweep);
+auto CrybabyEffect::process(ConstAudioView input, AudioView output) -> void {
+    size_t frame_count = input.get_frames();
+    alignas(32) std::array<float, LANES> in = {}, filtered;
+
+    // One control block (or what is left of it) at a time
+    for (size_t start = 0; start < frame_count;) {
+        if (control_left == 0) {
+            update_control();
+            control_left = CONTROL_BLOCK;
         }
-    }
+        size_t count = std::min<size_t>(control_left, frame_count - start);
+        control_left -= count;
+
+        // The envelopes are only read by the next update_control()
+        if (use_env_fol) {
+            for (int c = 0; c < ch_count; ++c) {
+                for (float sample : input.channel(c).subspan(start, count)) {
+                    envelopes[c] = env_fols[c].process(sample);
+                }
+            }
+        }
+
+        // LANES channels filtered at once
+        for (size_t bank = 0; bank < svfs.size(); ++bank) {
+            int first = bank * LANES;
+            int lanes = std::min<int>(LANES, ch_count - first);
+
+            for (size_t i = start; i < start + count; ++i) {
+                for (int lane = 0; lane < lanes; ++lane) {
+                    in[lane] = input.channel(first + lane)[i];
+                }
+
+                svfs[bank].process(in, filtered, PassFilterTypes::band_pass);
 
-    return output;
+                for (int lane = 0; lane < lanes; ++lane) {
+                    output.channel(first + lane)[i] =
+                        std::lerp(in[lane], filtered[lane], 0.8f);
+                }
+            }
+        }
+
+        start += count;
+    }
 }
 
 auto CrybabyEffect::get_filter_name() -> std::string { return "crybaby"; }
@@ -5,7 +5,7 @@
 
 #include "amp_filter.h"
 #include "envelope_follower.h"
-#include "svf.h"
+#include "svf_bank.h"
 
 class CrybabyEffect : public AMPFilter {
    private:
@@ -20,8 +20,20 @@ class CrybabyEffect : public AMPFilter {
     bool use_env_fol;
     float sweep = 0.0f;
 
-    EnvelopeFollower env_fol_l, env_fol_r;
-    SVF svf_left, svf_right;
+    // The sweep and the filter coefficients are updated once per control
+    // block, the SVFs glide between the updates
+    static constexpr int CONTROL_BLOCK = 32;
+    int control_left = 0;
+
+    // Channels per SVF bank, one SSE register
+    static constexpr size_t LANES = 4;
+
+    // One per channel, channel c is lane c % LANES of svfs[c / LANES]
+    std::vector<EnvelopeFollower> env_fols;
+    std::vector<float> envelopes;
+    std::vector<SVFBank<LANES>> svfs;
+
+    auto update_control() -> void;
 
    public:
     CrybabyEffect(uint8_t ch_count, uint32_t sample_rate,
@@ -36,17 +48,15 @@ class CrybabyEffect : public AMPFilter {
           start_cutoff(start_cutoff),
           end_cutoff(end_cutoff),
           use_env_fol(use_env_fol),
-          env_fol_l(sample_rate),
-          env_fol_r(sample_rate) {};
+          env_fols(ch_count, EnvelopeFollower(sample_rate)),
+          envelopes(ch_count, 0.0f),
+          svfs((ch_count + LANES - 1) / LANES) {}
 
-    auto apply(const std::vector<float>& input) -> std::vector<float> override;
+    auto process(ConstAudioView input, AudioView output) -> void override;
+    auto get_in_channels() -> int override { return ch_count; }
     auto get_tri_sweep(float sweep) -> float;
     auto get_cutoff_sweep_exp(float sweep) -> float;
     auto get_resonance_sweep(float sweep) -> float;
-    auto get_cutoff(EnvelopeFollower& env_fol, float input, float sweep)
-        -> float;
-    auto _process(SVF& svf, EnvelopeFollower& env_fol, float input,
-                  float tri_sweep, float resonance_sweep) -> float;
     auto get_filter_name() -> std::string override;
     auto get_output_dir(const std::string& audio_name) -> std::string override;
 };
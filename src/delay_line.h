@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <span>
+#include <variant>
+#include <vector>
+
+// Fractional delay interpolators for DelayLine. An interpolator reads `taps`
+// consecutive samples x[i0 - (taps / 2 - 1)] .. x[i0 + taps / 2] around the
+// position i0 + mu (0 <= mu < 1) and fills their weights. At mu = 0 the
+// weight of the last tap is 0, so a delay of taps / 2 - 1 frames never
+// reads an unwritten sample.
+
+// 2 taps. Dulls the highs of fractional delays: -3 dB at a quarter of the
+// sample rate half way between two samples.
+struct LinearInterp {
+    static constexpr int taps = 2;
+
+    auto weights(float mu, std::span<float, taps> w) const -> void {
+        w[0] = 1.0f - mu;
+        w[1] = mu;
+    }
+};
+
+// 4 tap (third order) Lagrange polynomial, -0.5 dB at a fifth of the
+// sample rate at worst
+struct CubicInterp {
+    static constexpr int taps = 4;
+
+    auto weights(float mu, std::span<float, taps> w) const -> void {
+        float before = mu + 1.0f;
+        float after = mu - 1.0f;
+        float after2 = mu - 2.0f;
+        w[0] = -mu * after * after2 * (1.0f / 6.0f);
+        w[1] = before * after * after2 * 0.5f;
+        w[2] = -before * mu * after2 * 0.5f;
+        w[3] = before * mu * after * (1.0f / 6.0f);
+    }
+};
+
+// 8 tap Blackman windowed sinc, -0.2 dB at a quarter of the sample rate at
+// worst.
+// The weights of PHASES + 1 fractional positions are tabulated once, the
+// ones in between are linearly interpolated.
+struct SincInterp {
+    static constexpr int taps = 8;
+    static constexpr int PHASES = 256;
+
+    using Table = std::array<std::array<float, taps>, PHASES + 1>;
+
+    SincInterp() : table(&shared_table()) {}
+
+    auto weights(float mu, std::span<float, taps> w) const -> void {
+        float position = mu * PHASES;
+        // mu rounds to 1 for delays a hair above an integer
+        int phase = std::min((int)position, PHASES - 1);
+        float frac = position - phase;
+        const auto& lower = (*table)[phase];
+        const auto& upper = (*table)[phase + 1];
+        for (int k = 0; k < taps; ++k) {
+            w[k] = lower[k] + frac * (upper[k] - lower[k]);
+        }
+    }
+
+   private:
+    static auto shared_table() -> const Table& {
+        static const Table table = [] {
+            constexpr double PI = std::numbers::pi;
+            constexpr double HALF_SPAN = taps / 2;
+            Table t;
+            for (int phase = 0; phase <= PHASES; ++phase) {
+                double mu = (double)phase / PHASES;
+                double sum = 0;
+                std::array<double, taps> row;
+                for (int k = 0; k < taps; ++k) {
+                    // Distance of the tap from the read position
+                    double x = (k - (taps / 2 - 1)) - mu;
+                    double sinc = x == 0 ? 1.0 : std::sin(PI * x) / (PI * x);
+                    double window = 0.42 + 0.5 * std::cos(PI * x / HALF_SPAN) +
+                                    0.08 * std::cos(2 * PI * x / HALF_SPAN);
+                    row[k] = sinc * window;
+                    sum += row[k];
+                }
+                // Unity gain at DC for every phase
+                for (int k = 0; k < taps; ++k) t[phase][k] = row[k] / sum;
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    const Table* table;
+};
+
+// Interpolation orders of the effects built on DelayLine
+enum class Interpolation { linear, cubic, sinc };
+
+// Multichannel fractional delay line: a planar ring per channel, indexed
+// modulo its power of two size with a mask.
+//
+// It works block by block: write() every channel's input of the block, read
+// any delays relative to the frames of the block, then advance() past it. The
+// batched read() fetches a whole block of taps at once, one delay per frame,
+// with the channel's ring and the interpolator resolved once per call. The
+// taps themselves stay scalar: every frame reads the ring at its own index,
+// which would need gathers.
+template <typename Interp>
+class DelayLine {
+   public:
+    static constexpr int taps = Interp::taps;
+
+    // Smallest readable delay, in frames
+    static constexpr int min_delay = taps / 2 - 1;
+
+    // Delays up to `max_delay` frames, in blocks of up to `max_block` frames
+    DelayLine(int channels, int max_delay, int max_block)
+        : size(std::bit_ceil((unsigned)(max_delay + max_block + taps))),
+          mask(size - 1),
+          samples((size_t)channels * size, 0.0f) {}
+
+    // `input` is the channel's frames 0..input.size() - 1 of the block
+    auto write(int channel, std::span<const float> input) -> void {
+        float* ring = samples.data() + (size_t)channel * size;
+        for (size_t i = 0; i < input.size(); ++i) {
+            ring[(write_pos + i) & mask] = input[i];
+        }
+    }
+
+    // Frame `frame` of the block delayed by `delay` (min_delay to max_delay)
+    // frames
+    auto read(int channel, int frame, float delay) const -> float {
+        const float* ring = samples.data() + (size_t)channel * size;
+        return tap(ring, write_pos + frame, delay);
+    }
+
+    // output[i] = read(channel, i, delays[i]) for every frame of `output`
+    auto read(int channel, std::span<const float> delays,
+              std::span<float> output) const -> void {
+        const float* ring = samples.data() + (size_t)channel * size;
+        for (size_t i = 0; i < output.size(); ++i) {
+            output[i] = tap(ring, write_pos + (int)i, delays[i]);
+        }
+    }
+
+    auto advance(int frames) -> void {
+        write_pos = (write_pos + frames) & mask;
+    }
+
+    auto reset() -> void {
+        std::fill(samples.begin(), samples.end(), 0.0f);
+        write_pos = 0;
+    }
+
+   private:
+    auto tap(const float* ring, int now, float delay) const -> float {
+        // Read position now - delay = i0 + mu
+        float whole = std::ceil(delay);
+        int i0 = now - (int)whole;
+        float mu = whole - delay;
+
+        alignas(32) std::array<float, taps> w;
+        interp.weights(mu, w);
+
+        float sum = 0.0f;
+        int first = i0 - (taps / 2 - 1);
+        for (int k = 0; k < taps; ++k) sum += w[k] * ring[(first + k) & mask];
+        return sum;
+    }
+
+    int size;
+    int mask;
+    std::vector<float> samples;
+    int write_pos = 0;
+    Interp interp;
+};
+
+// A DelayLine of any Interpolation, picked at run time. Effects dispatch on
+// it with std::visit, outside their per frame loops.
+using AnyDelayLine = std::variant<DelayLine<LinearInterp>,
+                                  DelayLine<CubicInterp>,
+                                  DelayLine<SincInterp>>;
+
+inline auto make_delay_line(Interpolation interpolation, int channels,
+                            int max_delay, int max_block) -> AnyDelayLine {
+    switch (interpolation) {
+        case Interpolation::cubic:
+            return DelayLine<CubicInterp>(channels, max_delay, max_block);
+        case Interpolation::sinc:
+            return DelayLine<SincInterp>(channels, max_delay, max_block);
+        default:
+            return DelayLine<LinearInterp>(channels, max_delay, max_block);
+    }
+}
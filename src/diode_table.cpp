@@ -0,0 +1,75 @@
+#include "diode_table.h"
+
+#include <cmath>
+#include <memory>
+
+auto DiodeTable::solve(double a, double& slope, bool from_below) -> double {
+    auto saturation = [&](double v) -> double {
+        bool reverse = v < 0 || (v == 0 && from_below);
+        return reverse ? diode::Is_reverse : diode::Is_forward;
+    };
+
+    // f(v) = v + R * Is * (exp(v / Vt) - 1) - a grows monotonically, its root
+    // lies between 0 and a. Newton steps leaving the bracket are replaced by
+    // bisection.
+    double low = std::min(0.0, a), high = std::max(0.0, a);
+    double v = a > 0 ? std::min(a, diode::Vt * std::log1p(
+                                        a / (diode::R * diode::Is_forward)))
+                     : a;
+
+    for (int k = 0; k < 100 && low < high; ++k) {
+        double Is = saturation(v);
+        double exp_val = std::exp(v / diode::Vt);
+        double f_v = v + diode::R * Is * (exp_val - 1.0) - a;
+        double f_prime = 1.0 + diode::R * Is / diode::Vt * exp_val;
+
+        if (f_v > 0) {
+            high = v;
+        } else {
+            low = v;
+        }
+
+        double next = v - f_v / f_prime;
+        if (!(next >= low && next <= high)) next = 0.5 * (low + high);
+        if (std::abs(next - v) < 1e-15) {
+            v = next;
+            break;
+        }
+        v = next;
+    }
+
+    // dv/da = 1 / f'(v), b = 2v - a
+    double f_prime =
+        1.0 + diode::R * saturation(v) / diode::Vt * std::exp(v / diode::Vt);
+    slope = 2.0 / f_prime - 1.0;
+    return 2.0 * v - a;
+}
+
+DiodeTable::DiodeTable(float limit, int segments_per_volt)
+    : limit(limit), scale((float)segments_per_volt) {
+    int segments = (int)std::ceil(2.0f * limit * segments_per_volt);
+    max_x = std::nextafter((float)segments, 0.0f);
+    coefficients.resize(segments);
+
+    double step = 1.0 / segments_per_volt;
+    for (int s = 0; s < segments; ++s) {
+        double a0 = -limit + s * step;
+        double a1 = a0 + step;
+
+        // Slopes from inside the segment
+        double d0, d1;
+        double b0 = solve(a0, d0, false);
+        double b1 = solve(a1, d1, true);
+        d0 *= step;
+        d1 *= step;
+
+        coefficients[s] = {(float)b0, (float)d0,
+                           (float)(3.0 * (b1 - b0) - 2.0 * d0 - d1),
+                           (float)(2.0 * (b0 - b1) + d0 + d1)};
+    }
+}
+
+auto DiodeTable::shared() -> std::shared_ptr<const DiodeTable> {
+    static const auto table = std::make_shared<const DiodeTable>();
+    return table;
+}
@@ -4,52 +4,124 @@
 
 #include <algorithm>
 #include <complex>
-#include <vector>
-
-enum class FFT_DIR { forward, backward };
+#include <mutex>
+#include <span>
+#include <string>
+#include <utility>
 
+// Real <-> complex FFT of a fixed size.
+// The aligned buffers and the plans are created once in the constructor, so
+// forward()/inverse() never allocate. Like FFTW the transforms are not
+// normalized: inverse(forward(x)) == size * x.
+//
+// FFTW's planner is global and not thread safe, creating and destroying plans
+// is serialized through planner_mutex(). Executing plans needs no locking.
 class FFT {
    public:
-    static auto compute(const std::vector<std::complex<float>>& input,
-                        FFT_DIR dir) -> std::vector<std::complex<float>> {
-        int nfft = input.size();
-        if (nfft == 0) return {};
-
-        // 1. Allocate FFTW-aligned memory
-        // We allocate separate buffers using fftwf_malloc to ensure 16-byte
-        // alignment required for AVX/SSE optimizations.
-        auto* in_raw =
-            (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * nfft);
-        auto* out_raw =
-            (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * nfft);
-
-        // 2. Copy data: std::vector -> FFTW Buffer
-        // We cast the FFTW buffer to std::complex* to use std::copy safely.
-        // This works because std::complex<float> and fftwf_complex are binary
-        // compatible.
-        std::copy(input.begin(), input.end(),
-                  reinterpret_cast<std::complex<float>*>(in_raw));
-
-        // 3. Create Plan
-        // FFTW_FORWARD = -1, FFTW_BACKWARD = +1
-        int fftw_dir = (dir == FFT_DIR::forward) ? FFTW_FORWARD : FFTW_BACKWARD;
-
-        // fftwf_plan_dft_1d handles Complex-to-Complex transforms
-        fftwf_plan plan =
-            fftwf_plan_dft_1d(nfft, in_raw, out_raw, fftw_dir, FFTW_ESTIMATE);
-
-        // 4. Execute
-        fftwf_execute(plan);
-
-        // 5. Copy data: FFTW Buffer -> std::vector
-        std::vector<std::complex<float>> output(nfft);
-        auto* out_ptr = reinterpret_cast<std::complex<float>*>(out_raw);
-        output.assign(out_ptr, out_ptr + nfft);
-
-        fftwf_destroy_plan(plan);
-        fftwf_free(in_raw);
-        fftwf_free(out_raw);
-
-        return output;
+    // flags: FFTW planner rigor. FFTW_MEASURE is cheap once the wisdom for
+    // this size is loaded (see load_wisdom).
+    explicit FFT(int size, unsigned flags = FFTW_MEASURE) : size(size) {
+        std::lock_guard lock(planner_mutex());
+
+        time_data = fftwf_alloc_real(size);
+        freq_data = fftwf_alloc_complex(get_bins());
+
+        // Planning with FFTW_MEASURE overwrites the buffers
+        forward_plan =
+            fftwf_plan_dft_r2c_1d(size, time_data, freq_data, flags);
+        inverse_plan =
+            fftwf_plan_dft_c2r_1d(size, freq_data, time_data, flags);
+
+        std::fill_n(time_data, size, 0.0f);
+        std::fill_n(reinterpret_cast<float*>(freq_data), 2 * get_bins(), 0.0f);
     }
+
+    ~FFT() {
+        std::lock_guard lock(planner_mutex());
+
+        if (forward_plan) fftwf_destroy_plan(forward_plan);
+        if (inverse_plan) fftwf_destroy_plan(inverse_plan);
+        if (time_data) fftwf_free(time_data);
+        if (freq_data) fftwf_free(freq_data);
+    }
+
+    FFT(const FFT&) = delete;
+    auto operator=(const FFT&) -> FFT& = delete;
+
+    FFT(FFT&& other) noexcept
+        : size(other.size),
+          time_data(std::exchange(other.time_data, nullptr)),
+          freq_data(std::exchange(other.freq_data, nullptr)),
+          forward_plan(std::exchange(other.forward_plan, nullptr)),
+          inverse_plan(std::exchange(other.inverse_plan, nullptr)) {}
+
+    auto operator=(FFT&& other) noexcept -> FFT& {
+        std::swap(size, other.size);
+        std::swap(time_data, other.time_data);
+        std::swap(freq_data, other.freq_data);
+        std::swap(forward_plan, other.forward_plan);
+        std::swap(inverse_plan, other.inverse_plan);
+        return *this;
+    }
+
+    auto get_size() const -> int { return size; }
+
+    // Number of non redundant bins of a real signal's spectrum
+    auto get_bins() const -> int { return size / 2 + 1; }
+
+    // Time domain buffer (get_size() samples)
+    auto real() -> std::span<float> { return {time_data, (size_t)size}; }
+
+    // Frequency domain buffer (get_bins() bins)
+    auto spectrum() -> std::span<std::complex<float>> {
+        // std::complex<float> and fftwf_complex are binary compatible
+        return {reinterpret_cast<std::complex<float>*>(freq_data),
+                (size_t)get_bins()};
+    }
+
+    // real() -> spectrum()
+    auto forward() -> void { fftwf_execute(forward_plan); }
+
+    // spectrum() -> real(). The content of spectrum() is destroyed.
+    auto inverse() -> void { fftwf_execute(inverse_plan); }
+
+    // Copies `input` into real() (zero padded to get_size()) and transforms it
+    // into `output`, which must hold get_bins() bins.
+    auto forward(std::span<const float> input,
+                 std::span<std::complex<float>> output) -> void {
+        auto time = real();
+        size_t count = std::min(input.size(), time.size());
+        std::copy_n(input.begin(), count, time.begin());
+        std::fill(time.begin() + count, time.end(), 0.0f);
+
+        forward();
+
+        auto freq = spectrum();
+        std::copy(freq.begin(), freq.end(), output.begin());
+    }
+
+    // Loads previously saved planner wisdom, making FFTW_MEASURE plans for
+    // known sizes close to free. Returns false if the file is missing.
+    static auto load_wisdom(const std::string& path) -> bool {
+        std::lock_guard lock(planner_mutex());
+        return fftwf_import_wisdom_from_filename(path.c_str()) != 0;
+    }
+
+    // Stores the wisdom gathered by every plan created so far
+    static auto save_wisdom(const std::string& path) -> bool {
+        std::lock_guard lock(planner_mutex());
+        return fftwf_export_wisdom_to_filename(path.c_str()) != 0;
+    }
+
+   private:
+    static auto planner_mutex() -> std::mutex& {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    int size;
+    float* time_data;
+    fftwf_complex* freq_data;
+    fftwf_plan forward_plan;
+    fftwf_plan inverse_plan;
 };
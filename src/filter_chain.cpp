@@ -0,0 +1,216 @@
+#include "filter_chain.h"
+
+#include <algorithm>
+#include <format>
+#include <numbers>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "binaural_mixer.h"
+#include "binaural_panner.h"
+#include "bit-crusher.h"
+#include "crybaby.h"
+#include "harmonizer.h"
+#include "overdrive.h"
+#include "oversampler.h"
+#include "pitch_shifter.h"
+#include "rt_check.h"
+#include "trace.h"
+
+auto get_max_channels(std::span<AMPFilter* const> filters, int in_channels)
+    -> int {
+    int max_channels = in_channels;
+    for (auto filter : filters) {
+        max_channels = std::max(max_channels, filter->get_out_channels());
+    }
+    return max_channels;
+}
+
+auto run_filters(std::span<AMPFilter* const> filters, AudioBuffer* curr,
+                 AudioBuffer* next, size_t frames) -> AudioBuffer* {
+    rt_check::BlockScope block(frames);
+
+    for (auto filter : filters) {
+        int in_channels = filter->get_in_channels();
+        int out_channels = filter->get_out_channels();
+
+        // Recording the span may allocate, outside of the checked scope
+        trace::Span span(*filter, frames);
+        rt_check::FilterScope scope(filter);
+
+        if (out_channels == in_channels) {
+            filter->process(curr->view(in_channels, frames),
+                            curr->view(out_channels, frames));
+        } else {
+            filter->process(std::as_const(*curr).view(in_channels, frames),
+                            next->view(out_channels, frames));
+            std::swap(curr, next);
+        }
+    }
+    return curr;
+}
+
+auto parse_chain(const std::string& definition) -> std::vector<std::string> {
+    std::vector<std::string> names;
+    std::stringstream stream(definition);
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+        if (!name.empty()) names.push_back(name);
+    }
+    return names;
+}
+
+namespace {
+// Takes the parameters of `params` one by one, so unknown ones can be reported
+class ParamReader {
+   public:
+    ParamReader(const std::string& filter, const FilterParams& params)
+        : filter(filter), remaining(params) {}
+
+    auto get(const std::string& name, float default_value) -> float {
+        auto it = remaining.find(name);
+        if (it == remaining.end()) return default_value;
+
+        float value = it->second;
+        remaining.erase(it);
+        return value;
+    }
+
+    // Throws if a parameter wasn't used by the filter
+    auto check_all_used() const -> void {
+        if (!remaining.empty()) {
+            throw std::invalid_argument(filter + ": unknown parameter " +
+                                        remaining.begin()->first);
+        }
+    }
+
+   private:
+    std::string filter;
+    FilterParams remaining;
+};
+
+// The "interpolation" parameter of the DelayLine based filters
+auto get_interpolation(ParamReader& p, const std::string& name)
+    -> Interpolation {
+    auto interpolation = (int)p.get("interpolation", 0);
+    if (interpolation < 0 || interpolation > 2) {
+        throw std::invalid_argument(name +
+                                    ": interpolation must be 0, 1 or 2");
+    }
+    return (Interpolation)interpolation;
+}
+}  // namespace
+
+auto make_filter(const std::string& name, int channels, float sample_rate,
+                 const ChainResources& resources, const FilterParams& params)
+    -> std::unique_ptr<AMPFilter> {
+    ParamReader p(name, params);
+    std::unique_ptr<AMPFilter> filter;
+
+    // The filter itself runs at the oversampled rate
+    int oversample = p.get("oversample", 1);
+    if (oversample < 1) {
+        throw std::invalid_argument(name + ": oversample must be positive");
+    }
+    sample_rate *= oversample;
+
+    if (name == "bitcrusher") {
+        filter = std::make_unique<BitcrusherFilter>(
+            channels, p.get("bits", 8), p.get("downsample", 8));
+    } else if (name == "crybaby") {
+        filter = std::make_unique<CrybabyEffect>(
+            channels, sample_rate, p.get("resonance_start", 0.85),
+            p.get("resonance_factor", 0.12), p.get("sweep_speed_hz", 1.5),
+            p.get("start_cutoff", 450), p.get("end_cutoff", 2500),
+            p.get("use_env_fol", 1) != 0);
+    } else if (name == "overdrive") {
+        auto mode = p.get("table", 0) != 0 ? ScatteringMode::table
+                                           : ScatteringMode::newton;
+        filter = std::make_unique<Overdrive>(p.get("resistance", 1000.0f),
+                                             sample_rate, channels, mode);
+    } else if (name == "pitchshifter") {
+        filter = std::make_unique<PitchShifter>(
+            p.get("pitch_factor", 1.5), sample_rate, channels,
+            p.get("vocoder", 0) != 0, get_interpolation(p, name));
+    } else if (name == "harmonizer") {
+        auto voice_count = (int)p.get("voices", 3);
+        if (voice_count < 1 || voice_count > 8) {
+            throw std::invalid_argument("harmonizer: 1 to 8 voices");
+        }
+
+        // An octave down on the left, the dry pitch, an octave up on the
+        // right
+        std::vector<HarmonizerVoice> voices(voice_count);
+        for (int v = 0; v < voice_count; ++v) {
+            HarmonizerVoice defaults{1.0f, 0.5f, 0.0f};
+            if (v == 0) defaults = {0.5f, 0.5f, -0.5f};
+            if (v == 2) defaults = {2.0f, 0.5f, 0.5f};
+
+            auto key = [&](const char* param) {
+                return std::format("{}_{}", param, v + 1);
+            };
+            voices[v] = {p.get(key("pitch"), defaults.pitch_factor),
+                         p.get(key("gain"), defaults.gain),
+                         p.get(key("pan"), defaults.pan)};
+        }
+        filter = std::make_unique<Harmonizer>(std::move(voices), sample_rate,
+                                              channels,
+                                              get_interpolation(p, name));
+    } else if (name == "cabinet") {
+        if (!resources.cabinet_ir) {
+            throw std::invalid_argument("cabinet: no cabinet IR loaded");
+        }
+        filter = std::make_unique<CabinetConvolver>(resources.cabinet_ir);
+    } else if (name == "binaural_rotation") {
+        bool woodworth_delay = p.get("woodworth_delay", 1) != 0;
+        bool apply_svf = p.get("apply_svf", 1) != 0;
+        float rotation_speed = p.get("rotation_speed", 0.7);
+
+        if (p.get("hrtf", resources.hrirs ? 1 : 0) != 0) {
+            if (!resources.hrirs) {
+                throw std::invalid_argument(
+                    "binaural_rotation: no HRIR set loaded");
+            }
+            filter = std::make_unique<BinauralPanner>(
+                channels, sample_rate, resources.hrirs, rotation_speed);
+        } else {
+            filter = std::make_unique<BinauralPanner>(
+                channels, sample_rate, woodworth_delay, apply_svf,
+                rotation_speed);
+        }
+    } else if (name == "binaural_mixer") {
+        float rotation_speed = p.get("rotation_speed", 0.7);
+        bool woodworth_delay = p.get("woodworth_delay", 1) != 0;
+        bool apply_svf = p.get("apply_svf", 1) != 0;
+
+        // Every input channel is a source, spread evenly around the head
+        std::vector<BinauralSource> sources(channels);
+        for (int s = 0; s < channels; ++s) {
+            sources[s] = {2.0f * std::numbers::pi_v<float> * s / channels,
+                          rotation_speed};
+        }
+        filter = std::make_unique<BinauralMixer>(
+            std::move(sources), sample_rate, woodworth_delay, apply_svf);
+    } else {
+        throw std::invalid_argument("Unknown filter: " + name);
+    }
+
+    p.check_all_used();
+
+    if (oversample > 1) {
+        filter = std::make_unique<Oversampler>(std::move(filter), oversample);
+    }
+    return filter;
+}
+
+auto make_chain(const std::vector<std::string>& names, int channels,
+                float sample_rate, const ChainResources& resources)
+    -> std::vector<std::unique_ptr<AMPFilter>> {
+    std::vector<std::unique_ptr<AMPFilter>> chain;
+    for (const auto& name : names) {
+        chain.push_back(make_filter(name, channels, sample_rate, resources));
+        channels = chain.back()->get_out_channels();
+    }
+    return chain;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "amp_filter.h"
+#include "cabinet.h"
+#include "hrtf.h"
+
+// The chain rendered by default, see parse_chain
+inline const std::string DEFAULT_CHAIN =
+    "bitcrusher,crybaby,overdrive,pitchshifter,cabinet,binaural_rotation";
+
+// Immutable resources shared by every chain built from them
+struct ChainResources {
+    // Required by "cabinet"
+    std::shared_ptr<const CabinetIR> cabinet_ir;
+
+    // Required by "binaural_rotation" in HRTF mode, which it turns on by
+    // default
+    std::shared_ptr<const HRIRSet> hrirs;
+};
+
+// Constructor parameters of a filter by name, e.g. {"pitch_factor", 0.5}.
+// Missing parameters take the filter's default value.
+using FilterParams = std::map<std::string, float>;
+
+// Filter names of a comma separated chain definition (see DEFAULT_CHAIN)
+auto parse_chain(const std::string& definition) -> std::vector<std::string>;
+
+// Builds the filter whose get_filter_name() is `name`. Throws
+// std::invalid_argument for unknown filters or parameters.
+//  bitcrusher:        bits, downsample
+//  crybaby:           resonance_start, resonance_factor, sweep_speed_hz,
+//                     start_cutoff, end_cutoff, use_env_fol
+//  overdrive:         resistance, table
+//  pitchshifter:      pitch_factor, vocoder, interpolation (0 linear,
+//                     1 cubic, 2 sinc, not with vocoder)
+//  harmonizer:        voices (1 to 8), pitch_N, gain_N, pan_N for voice N
+//                     (1 based), interpolation
+//  cabinet:           -
+//  binaural_rotation: rotation_speed, woodworth_delay, apply_svf, hrtf
+//  binaural_mixer:    rotation_speed, woodworth_delay, apply_svf
+// Every filter also takes "oversample" (1, 2, 4 or 8), which runs it inside an
+// Oversampler.
+auto make_filter(const std::string& name, int channels, float sample_rate,
+                 const ChainResources& resources,
+                 const FilterParams& params = {})
+    -> std::unique_ptr<AMPFilter>;
+
+// Builds a whole chain, `channels` being the channel count of its input
+auto make_chain(const std::vector<std::string>& names, int channels,
+                float sample_rate, const ChainResources& resources)
+    -> std::vector<std::unique_ptr<AMPFilter>>;
+
+// Widest channel count used by any stage of `filters`, `in_channels` being the
+// channel count of the chain's input
+auto get_max_channels(std::span<AMPFilter* const> filters, int in_channels)
+    -> int;
+
+// Runs `filters` in order over the first `frames` frames of `curr`.
+// Filters keeping the channel count run in place, the others write into
+// `next` and the two buffers swap roles. Both buffers must have
+// get_max_channels() channels of at least `frames` frames. Returns the buffer
+// with the result.
+auto run_filters(std::span<AMPFilter* const> filters, AudioBuffer* curr,
+                 AudioBuffer* next, size_t frames) -> AudioBuffer*;
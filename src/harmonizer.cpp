@@ -0,0 +1,125 @@
+#include "harmonizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <numbers>
+#include <stdexcept>
+
+Harmonizer::Harmonizer(std::vector<HarmonizerVoice> voices, float sample_rate,
+                       int channels, Interpolation interpolation)
+    : voices(std::move(voices)),
+      channels(channels),
+      interpolation(interpolation),
+      // same grain as PitchShifter
+      grain_frames(static_cast<size_t>(0.050f * sample_rate)),
+      // The taps read up to a grain plus the interpolator's minimum delay
+      delay_line(make_delay_line(interpolation, 1, (int)grain_frames + 8,
+                                 MAX_BLOCK)) {
+    if (this->voices.empty()) {
+        throw std::invalid_argument("harmonizer: no voice");
+    }
+
+    mono.resize(MAX_BLOCK);
+
+    phasor.assign(this->voices.size(), 0.0);
+    for (const HarmonizerVoice& voice : this->voices) {
+        // See PitchShifter::process
+        phase_increment.push_back((1.0f - voice.pitch_factor) / grain_frames);
+
+        float angle = (std::clamp(voice.pan, -1.0f, 1.0f) + 1.0f) * 0.25f *
+                      std::numbers::pi_v<float>;
+        gain_l.push_back(voice.gain * std::cos(angle));
+        gain_r.push_back(voice.gain * std::sin(angle));
+    }
+}
+
+auto Harmonizer::get_latency() -> int {
+    return std::visit([](const auto& line) { return line.min_delay; },
+                      delay_line);
+}
+
+auto Harmonizer::process(ConstAudioView input, AudioView output) -> void {
+    size_t frames = input.get_frames();
+    auto grain = (float)grain_frames;
+    auto min_delay = (float)get_latency();
+
+    GrainTaps trajectory;
+    alignas(32) std::array<float, MAX_BLOCK> sample_a, sample_b, mix_l, mix_r;
+
+    for (size_t start = 0; start < frames; start += MAX_BLOCK) {
+        size_t count = std::min(MAX_BLOCK, frames - start);
+
+        // The mean of the channels, so the voices' level doesn't depend on
+        // their count. Downmixed before the output is written, it may be the
+        // input.
+        auto first = input.channel(0).subspan(start, count);
+        std::copy(first.begin(), first.end(), mono.begin());
+        for (int c = 1; c < channels; ++c) {
+            auto other = input.channel(c).subspan(start, count);
+            for (size_t i = 0; i < count; ++i) mono[i] += other[i];
+        }
+        float scale = 1.0f / channels;
+        for (size_t i = 0; i < count; ++i) mono[i] *= scale;
+
+        // Mixed on the stack, where the compiler sees they alias no tap
+        std::fill_n(mix_l.begin(), count, 0.0f);
+        std::fill_n(mix_r.begin(), count, 0.0f);
+
+        std::visit(
+            [&](auto& line) { line.write(0, std::span(mono).first(count)); },
+            delay_line);
+
+        for (size_t v = 0; v < voices.size(); ++v) {
+            trajectory.compute(phasor[v], phase_increment[v], grain,
+                               min_delay, count);
+
+            std::visit(
+                [&](const auto& line) {
+                    line.read(0, std::span(trajectory.delay_a).first(count),
+                              std::span(sample_a).first(count));
+                    line.read(0, std::span(trajectory.delay_b).first(count),
+                              std::span(sample_b).first(count));
+                },
+                delay_line);
+
+            float l = gain_l[v], r = gain_r[v];
+            for (size_t i = 0; i < count; ++i) {
+                float voice = (sample_a[i] * trajectory.weight_a[i]) +
+                              (sample_b[i] * trajectory.weight_b[i]);
+                mix_l[i] += voice * l;
+                mix_r[i] += voice * r;
+            }
+        }
+
+        std::visit([&](auto& line) { line.advance(count); }, delay_line);
+
+        std::copy_n(mix_l.begin(), count, output.channel(0).begin() + start);
+        std::copy_n(mix_r.begin(), count, output.channel(1).begin() + start);
+    }
+}
+
+auto Harmonizer::get_filter_name() -> std::string { return "harmonizer"; }
+
+auto Harmonizer::get_output_dir(const std::string& audio_name)
+    -> std::string {
+    namespace fs = std::filesystem;
+    // pitch_gain_pan of every voice
+    std::string params_str;
+    for (const auto& voice : voices) {
+        if (!params_str.empty()) params_str += "__";
+        params_str += std::format("{:.2f}_{:.2f}_{:.2f}", voice.pitch_factor,
+                                  voice.gain, voice.pan);
+    }
+    if (interpolation == Interpolation::cubic) {
+        params_str += "_cubic";
+    } else if (interpolation == Interpolation::sinc) {
+        params_str += "_sinc";
+    }
+
+    fs::path audio_out_path =
+        fs::path(get_filter_name()) / audio_name / params_str;
+    return audio_out_path.string();
+}
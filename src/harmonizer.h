@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "amp_filter.h"
+#include "delay_line.h"
+#include "pitch_shifter.h"
+
+// One pitch shifted voice of a Harmonizer
+struct HarmonizerVoice {
+    float pitch_factor = 1.0f;
+    float gain = 1.0f;
+    float pan = 0.0f;  // -1 (left) to 1 (right), constant power
+};
+
+// Several voices of PitchShifter's two tap delay line shifter, mixed into a
+// stereo output. The input (downmixed to mono, the mean of its channels) is
+// written once into a single history that every voice reads.
+//
+// Block by block, each voice computes the delays and triangle windows of its
+// two taps for all the frames at once with PitchShifter's GrainTaps, in a
+// loop the compiler vectorizes. Its taps are then fetched with batched reads
+// of the shared DelayLine and mixed.
+//
+// Only the memory and the input's downmix and write are shared. The
+// interpolated reads dominate, and every voice needs its own: they are
+// scalar gathers from the ring. N voices cost about as much CPU as N mono
+// PitchShifters, not well under it.
+class Harmonizer : public AMPFilter {
+   public:
+    // Throws std::invalid_argument without voices
+    Harmonizer(std::vector<HarmonizerVoice> voices, float sample_rate,
+               int channels,
+               Interpolation interpolation = Interpolation::linear);
+
+    auto process(ConstAudioView input, AudioView output) -> void override;
+    auto get_in_channels() -> int override { return channels; }
+    auto get_out_channels() -> int override { return 2; }
+    auto get_latency() -> int override;
+    auto get_output_dir(const std::string& audio_name) -> std::string override;
+    auto get_filter_name() -> std::string override;
+
+   private:
+    // Frames downmixed, written into the history and read at once
+    static constexpr size_t MAX_BLOCK = GrainTaps::MAX_BLOCK;
+
+    std::vector<HarmonizerVoice> voices;
+    int channels;
+    Interpolation interpolation;
+    size_t grain_frames;
+
+    // The mono input of every voice
+    AnyDelayLine delay_line;
+    std::vector<float> mono;
+
+    // Per voice
+    std::vector<double> phasor, phase_increment;
+    std::vector<float> gain_l, gain_r;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+
+// The spherical head shared by BinauralPanner and BinauralMixer: interaural
+// time difference, and the head shadow low pass cutoffs of both ears.
+// Angles are in radians, clockwise from the front (positive sines are on the
+// right). Branchless, so loops over frames or sources vectorize.
+namespace head_model {
+constexpr float HEAD_RADIUS = 0.0875f;  // meters
+constexpr float SPEED_OF_SOUND = 340.0f;  // meters per second
+
+// Largest ITD of the simple model, in seconds
+constexpr float SIMPLE_MAX_ITD = 0.00065f;
+
+constexpr float SHADOW_RESONANCE = 0.5f;
+
+// `angle` in [0, 2 pi) folded into [0, pi / 2]: the absolute shortest angle
+// to the median plane (0 is front or back). With abs, float comparisons keep
+// loops scalar.
+inline auto fold_to_median(float angle) -> float {
+    constexpr float HALF_PI = 0.5f * std::numbers::pi_v<float>;
+    constexpr float PI = std::numbers::pi_v<float>;
+    return HALF_PI - std::abs(std::abs(angle - PI) - HALF_PI);
+}
+
+// Delay of the far ear in frames. Woodworth's formula
+// r * (theta + sin(theta)) / c with theta = fold_to_median(angle), or
+// |sin(angle)| * SIMPLE_MAX_ITD. The selects on the model are made once, at
+// construction, out of the callers' loops.
+struct Itd {
+    Itd(float sample_rate, bool woodworth)
+        : scale((woodworth ? HEAD_RADIUS / SPEED_OF_SOUND : SIMPLE_MAX_ITD) *
+                sample_rate),
+          theta_weight(woodworth ? 1.0f : 0.0f) {}
+
+    auto frames(float theta, float sin_val) const -> float {
+        return scale * (theta_weight * theta + std::abs(sin_val));
+    }
+
+    float scale;
+    float theta_weight;
+};
+
+inline auto itd_frames(float theta, float sin_val, float sample_rate,
+                       bool woodworth) -> float {
+    return Itd(sample_rate, woodworth).frames(theta, sin_val);
+}
+
+// Largest itd_frames() of both models
+inline auto max_itd_frames(float sample_rate) -> float {
+    constexpr float HALF_PI = 0.5f * std::numbers::pi_v<float>;
+    return std::max(itd_frames(HALF_PI, 1.0f, sample_rate, true),
+                    itd_frames(HALF_PI, 1.0f, sample_rate, false));
+}
+
+// Normalized low pass cutoffs (left, right) of the ears for a source at the
+// angle of (cos_val, sin_val): open in front, darker for the shadowed ear
+// and behind the head
+inline auto shadow_cutoffs(float cos_val, float sin_val)
+    -> std::array<float, 2> {
+    constexpr float NORMAL_CUTOFF = 0.99f;
+    constexpr float SHADOW_CUTOFF = 0.35f;
+    constexpr float REAR_CUTOFF = 0.20f;
+
+    // Calculate a Front-Back factor (0.0 = front, 1.0 = back)
+    float back_factor = std::clamp((1.0f - cos_val) * 0.5f, 0.0f, 1.0f);
+
+    // Calculate Side factors (0.0 = near, 1.0 = far/shadowed)
+    // For Left ear, sin_val = 1 is "far" (right side).
+    float shadow_l = std::clamp(sin_val, 0.0f, 1.0f);
+    // For Right ear, sin_val = -1 is "far" (left side).
+    float shadow_r = std::clamp(-sin_val, 0.0f, 1.0f);
+
+    // Smoothly interpolate the cutoffs
+    float cutoff_l = std::lerp(NORMAL_CUTOFF, SHADOW_CUTOFF, shadow_l);
+    float cutoff_r = std::lerp(NORMAL_CUTOFF, SHADOW_CUTOFF, shadow_r);
+    return {std::lerp(cutoff_l, REAR_CUTOFF, back_factor),
+            std::lerp(cutoff_r, REAR_CUTOFF, back_factor)};
+}
+}  // namespace head_model
@@ -0,0 +1,224 @@
+#include "hrtf.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <filesystem>
+#include <numbers>
+#include <stdexcept>
+
+#include "audio_buffer.h"
+#include "audio_handler.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr float TWO_PI = 2.0f * std::numbers::pi_v<float>;
+
+// Into [0, 2 pi)
+auto wrap_angle(float angle) -> float {
+    angle = std::fmod(angle, TWO_PI);
+    return angle < 0.0f ? angle + TWO_PI : angle;
+}
+
+// The last (signed, maybe fractional) number of `name`
+auto parse_azimuth(const std::string& name) -> std::optional<float> {
+    auto last_digit = std::find_if(name.rbegin(), name.rend(), [](char c) {
+        return std::isdigit((unsigned char)c);
+    });
+    if (last_digit == name.rend()) return std::nullopt;
+
+    auto first = std::find_if(last_digit, name.rend(), [](char c) {
+        return !std::isdigit((unsigned char)c) && c != '.';
+    });
+    if (first != name.rend() && *first == '-') ++first;
+
+    size_t begin = name.rend() - first;
+    size_t end = name.rend() - last_digit;
+    return std::stof(name.substr(begin, end - begin));
+}
+}  // namespace
+
+HRIRSet::HRIRSet(const std::string& dir, int partition_size)
+    : partition_size(partition_size) {
+    struct Loaded {
+        float azimuth;
+        std::vector<float> ears[2];
+    };
+    std::vector<Loaded> loaded;
+    size_t max_frames = 1;
+
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator(dir, error)) {
+        const fs::path& path = entry.path();
+        if (!entry.is_regular_file() || path.extension() != ".wav") continue;
+
+        auto azimuth = parse_azimuth(path.stem().string());
+        if (!azimuth) {
+            throw std::runtime_error("HRIRSet: No azimuth in the name of " +
+                                     path.string());
+        }
+
+        AudioFileHandler fh;
+        if (!fh.open_read(path.string())) {
+            throw std::runtime_error("HRIRSet: Failed to load " +
+                                     path.string());
+        }
+        if (fh.get_channels() != 2) {
+            throw std::runtime_error("HRIRSet: Not a stereo file: " +
+                                     path.string());
+        }
+        if (sample_rate != 0 && fh.get_sample_rate() != sample_rate) {
+            throw std::runtime_error("HRIRSet: Mixed sample rates in " + dir);
+        }
+        sample_rate = fh.get_sample_rate();
+
+        AudioBuffer ir(2, fh.get_total_frames());
+        size_t frames = fh.read_frames(ir.view());
+        max_frames = std::max(max_frames, frames);
+
+        Loaded& direction = loaded.emplace_back();
+        direction.azimuth = wrap_angle(*azimuth * std::numbers::pi_v<float> /
+                                       180.0f);
+        for (int ear = 0; ear < 2; ++ear) {
+            direction.ears[ear].assign(ir.channel(ear), ir.channel(ear) + frames);
+        }
+    }
+
+    if (error || loaded.empty()) {
+        throw std::runtime_error("HRIRSet: No HRIR in " + dir);
+    }
+
+    std::ranges::sort(loaded, {}, &Loaded::azimuth);
+    for (size_t i = 1; i < loaded.size(); ++i) {
+        if (loaded[i].azimuth == loaded[i - 1].azimuth) {
+            throw std::runtime_error("HRIRSet: Duplicate azimuth in " + dir);
+        }
+    }
+
+    // Zero padded to the longest IR, so every direction has the same amount
+    // of partitions
+    for (auto& direction : loaded) {
+        for (auto& ear : direction.ears) ear.resize(max_frames, 0.0f);
+        directions.push_back(
+            {direction.azimuth,
+             {IRPartitions(direction.ears[0], partition_size),
+              IRPartitions(direction.ears[1], partition_size)}});
+    }
+    partition_count = directions.front().ears[0].get_partition_count();
+}
+
+auto HRIRSet::locate(float angle) const -> Neighbours {
+    size_t count = directions.size();
+    if (count == 1) return {0, 0, 0.0f};
+
+    angle = wrap_angle(angle);
+    auto upper = std::ranges::upper_bound(directions, angle, {},
+                                          &Direction::azimuth);
+    size_t second = (upper - directions.begin()) % count;
+    size_t first = (second + count - 1) % count;
+
+    // Across 0 the gap wraps around
+    float gap = wrap_angle(directions[second].azimuth -
+                           directions[first].azimuth);
+    float offset = wrap_angle(angle - directions[first].azimuth);
+    return {first, second, gap > 0.0f ? offset / gap : 0.0f};
+}
+
+HRTFRenderer::HRTFRenderer(std::shared_ptr<const HRIRSet> hrirs)
+    : hrirs(std::move(hrirs)),
+      partition_size(this->hrirs->get_partition_size()),
+      partition_count(this->hrirs->get_partition_count()),
+      fft(2 * partition_size) {
+    window.resize(2 * partition_size, 0.0f);
+    fdl.resize(partition_count * fft.get_bins());
+    for (auto& ear : output) ear.resize(partition_size, 0.0f);
+    faded.resize(partition_size);
+}
+
+auto HRTFRenderer::process(std::span<const float> input,
+                           std::span<float> left, std::span<float> right,
+                           float angle, float angle_step) -> void {
+    size_t done = 0;
+    while (done < input.size()) {
+        size_t count =
+            std::min<size_t>(input.size() - done, partition_size - fill);
+
+        std::copy_n(input.begin() + done, count,
+                    window.begin() + partition_size + fill);
+        std::copy_n(output[0].begin() + fill, count, left.begin() + done);
+        std::copy_n(output[1].begin() + fill, count, right.begin() + done);
+
+        fill += count;
+        done += count;
+        angle += count * angle_step;
+
+        if (fill == partition_size) {
+            render_block(angle);
+            fill = 0;
+        }
+    }
+}
+
+auto HRTFRenderer::render_block(float angle) -> void {
+    const int bins = fft.get_bins();
+
+    std::copy(window.begin(), window.end(), fft.real().begin());
+    fft.forward();
+    std::copy_n(fft.spectrum().begin(), bins, fdl.begin() + fdl_pos * bins);
+
+    HRIRSet::Neighbours current = hrirs->locate(angle);
+    bool moved = previous && *previous != current;
+
+    for (int ear = 0; ear < 2; ++ear) {
+        if (moved) {
+            convolve(*previous, ear);
+            std::copy_n(fft.real().begin() + partition_size, partition_size,
+                        faded.begin());
+        }
+
+        convolve(current, ear);
+
+        // Overlap-save: only the second half is free of circular wrap around
+        const float* fresh = fft.real().data() + partition_size;
+        float* out = output[ear].data();
+        if (moved) {
+            for (int i = 0; i < partition_size; ++i) {
+                float gain = (float)(i + 1) / partition_size;
+                out[i] = std::lerp(faded[i], fresh[i], gain);
+            }
+        } else {
+            std::copy_n(fresh, partition_size, out);
+        }
+    }
+    previous = current;
+
+    std::copy(window.begin() + partition_size, window.end(), window.begin());
+    fdl_pos = (fdl_pos + partition_count - 1) % partition_count;
+}
+
+auto HRTFRenderer::convolve(const HRIRSet::Neighbours& neighbours, int ear)
+    -> void {
+    const int bins = fft.get_bins();
+    const auto& directions = hrirs->get_directions();
+    const IRPartitions& first = directions[neighbours.first].ears[ear];
+    const IRPartitions& second = directions[neighbours.second].ears[ear];
+    float frac = neighbours.frac;
+
+    auto spectrum = fft.spectrum();
+    std::fill(spectrum.begin(), spectrum.end(), std::complex<float>{0, 0});
+
+    for (int p = 0; p < partition_count; ++p) {
+        int slot = (fdl_pos + p) % partition_count;
+        const std::complex<float>* x = fdl.data() + slot * bins;
+        const std::complex<float>* a = first.get_spectrum(p).data();
+        const std::complex<float>* b = second.get_spectrum(p).data();
+
+        // Interpolating the spectra interpolates the IRs
+        for (int k = 0; k < bins; ++k) {
+            spectrum[k] += x[k] * (a[k] + frac * (b[k] - a[k]));
+        }
+    }
+
+    fft.inverse();
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "convolver.h"
+#include "fft.h"
+
+// A set of head related impulse responses measured on the horizontal plane,
+// one stereo WAV file per azimuth, read from a directory.
+//
+// The azimuth of a file is the last number of its name, in degrees clockwise
+// from the front (e.g. "azi_90.wav" or MIT KEMAR's "H0e090a.wav" are on the
+// right). The IRs are partitioned and transformed once, with the same amount
+// of partitions for every direction. Immutable, so it can be shared by any
+// number of HRTFRenderers.
+class HRIRSet {
+   public:
+    // Throws std::runtime_error if `dir` holds no readable stereo WAV file
+    // with an azimuth, or if the files have different sample rates
+    explicit HRIRSet(const std::string& dir, int partition_size = 128);
+
+    // Left (0) and right (1) ear IRs of one direction
+    struct Direction {
+        float azimuth;  // radians, in [0, 2 pi)
+        IRPartitions ears[2];
+    };
+
+    auto get_directions() const -> const std::vector<Direction>& {
+        return directions;
+    }
+    auto get_sample_rate() const -> int { return sample_rate; }
+    auto get_partition_size() const -> int { return partition_size; }
+    auto get_partition_count() const -> int { return partition_count; }
+
+    // The measured directions around `angle` (radians, clockwise from the
+    // front): its filter is lerp(filter(first), filter(second), frac)
+    struct Neighbours {
+        size_t first, second;
+        float frac;
+
+        auto operator==(const Neighbours&) const -> bool = default;
+    };
+    auto locate(float angle) const -> Neighbours;
+
+   private:
+    int sample_rate = 0;
+    int partition_size;
+    int partition_count = 0;
+    std::vector<Direction> directions;
+};
+
+// Binaural rendering of a moving mono source through an HRIRSet.
+//
+// Uniformly partitioned overlap-save convolution with one partition of
+// latency: every complete input partition is transformed once, its spectrum
+// is shared by both ears and both filters of the block, so a block always
+// costs one forward and at most four inverse FFTs, however many directions
+// the set has. The filter of a block is interpolated between the two
+// measured directions around the source, and the output crossfades from the
+// previous block's filter to it, so a moving source doesn't click.
+class HRTFRenderer {
+   public:
+    explicit HRTFRenderer(std::shared_ptr<const HRIRSet> hrirs);
+
+    // Frames between an input frame and its output
+    auto get_latency() const -> int { return partition_size; }
+
+    // `angle` is the source's angle (radians, clockwise from the front) at
+    // the first frame of `input`, growing by `angle_step` every frame
+    auto process(std::span<const float> input, std::span<float> left,
+                 std::span<float> right, float angle, float angle_step)
+        -> void;
+
+   private:
+    // Convolves the complete partition in `window` through the filter at
+    // `angle` into `output`
+    auto render_block(float angle) -> void;
+
+    // Sum of the FDL spectra times the filter of `neighbours` for `ear`,
+    // inverse transformed into fft.real()
+    auto convolve(const HRIRSet::Neighbours& neighbours, int ear) -> void;
+
+    std::shared_ptr<const HRIRSet> hrirs;
+    int partition_size;
+    int partition_count;
+
+    FFT fft;
+
+    // [previous partition | current partition]
+    std::vector<float> window;
+    int fill = 0;
+
+    // Spectra of the last `partition_count` windows, used as a ring
+    std::vector<std::complex<float>> fdl;
+    int fdl_pos = 0;
+
+    // Output of the last complete partition, per ear, played while the next
+    // one fills
+    std::vector<float> output[2];
+
+    // Filter of the previous block (none before the first one)
+    std::optional<HRIRSet::Neighbours> previous;
+    std::vector<float> faded;
+};
@@ -1,27 +1,367 @@
 #include <sndfile.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
+#include <exception>
 #include <filesystem>
 #include <format>
 #include <print>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
 #include <vector>
 
 #include "amp_filter.h"
 #include "audio_handler.h"
+#include "batch.h"
 #include "binaural_panner.h"
 #include "cabinet.h"
 #include "crybaby.h"
+#include "fft.h"
+#include "hrtf.h"
 #include "overdrive.h"
+#include "pipeline.h"
+#include "rt_check.h"
+#include "spectrogram.h"
 #include "svf.h"
+#include "sweep.h"
+#include "thread_pool.h"
+#include "trace.h"
 #include "bit-crusher.h"
 #include "pitch_shifter.h"
 
 namespace fs = std::filesystem;
 
-auto main() -> int {
+// Takes --window N, --hop N or --window-type {hann|hamming|blackman|
+// rectangular} at argv[i] into `options`. Returns false for other arguments,
+// throws std::invalid_argument on bad values.
+static auto parse_spectrogram_arg(int argc, char** argv, int& i,
+                                  SpectrogramOptions& options) -> bool {
+    std::string_view arg = argv[i];
+    if (i + 1 >= argc) return false;
+
+    if (arg == "--window") {
+        options.window_size = std::stoi(argv[++i]);
+    } else if (arg == "--hop") {
+        options.hop = std::stoi(argv[++i]);
+    } else if (arg == "--window-type") {
+        auto window = parse_window_type(argv[++i]);
+        if (!window) {
+            throw std::invalid_argument(
+                std::format("Unknown window type: {}", argv[i]));
+        }
+        options.window = *window;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// AudioProcessor --spectrogram <file|dir>... [--window N] [--hop N]
+//                [--window-type hann] [--threads N]
+// Writes the spectrograms of every file next to it (spect_ch_{i}.pgm)
+static auto run_spectrogram_command(int argc, char** argv,
+                                    const fs::path& root_dir) -> int {
+    std::vector<fs::path> inputs;
+    SpectrogramOptions options;
+    size_t thread_count = std::thread::hardware_concurrency();
+
+    try {
+        for (int i = 2; i < argc; ++i) {
+            std::string_view arg = argv[i];
+            if (parse_spectrogram_arg(argc, argv, i, options)) continue;
+
+            if (arg == "--threads" && i + 1 < argc) {
+                thread_count = std::stoul(argv[++i]);
+            } else {
+                for (const auto& file : collect_audio_files(argv[i])) {
+                    inputs.push_back(file);
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        std::print("[ERROR]: {}\n", e.what());
+        return -1;
+    }
+
+    if (inputs.empty()) {
+        std::print("[ERROR]: No input files\n");
+        return -1;
+    }
+
+    fs::path wisdom_path = root_dir / "fftw.wisdom";
+    FFT::load_wisdom(wisdom_path.string());
+
+    // One job per file, each transforming its columns as it reads
+    struct SpectrogramResult {
+        std::vector<fs::path> images;
+        std::string error;
+    };
+    std::vector<SpectrogramResult> results(inputs.size());
+
+    ThreadPool pool(thread_count);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        pool.submit([&result = results[i], &input = inputs[i], &options] {
+            try {
+                result.images = write_file_spectrogram(input, options);
+            } catch (const std::exception& e) {
+                result.error = e.what();
+            }
+        });
+    }
+    pool.wait();
+
+    int failed = 0;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (!results[i].error.empty()) {
+            std::print("[ERROR]: {}: {}\n", inputs[i].string(),
+                       results[i].error);
+            failed++;
+            continue;
+        }
+        for (const auto& image : results[i].images) {
+            std::print("[SPECTROGRAM]: {}\n", image.string());
+        }
+    }
+
+    FFT::save_wisdom(wisdom_path.string());
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// AudioProcessor --batch <file|dir>... [--chain a,b,c] [--threads N]
+//                [--spectrogram [--window N] [--hop N] [--window-type hann]]
+// Renders every input concurrently into output/combination/{audio_name}/
+static auto run_batch_command(int argc, char** argv, const fs::path& root_dir)
+    -> int {
+    std::vector<fs::path> inputs;
+    std::string chain_definition = DEFAULT_CHAIN;
+    size_t thread_count = std::thread::hardware_concurrency();
+    bool spectrogram = false;
+    SpectrogramOptions spectrogram_options;
+    std::string hrir_dir;
+    fs::path ir_path = root_dir / "samples" / "ir.wav";
+
+    for (int i = 2; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        try {
+            if (parse_spectrogram_arg(argc, argv, i, spectrogram_options)) {
+                continue;
+            }
+        } catch (const std::exception& e) {
+            std::print("[ERROR]: {}\n", e.what());
+            return -1;
+        }
+
+        if (arg == "--spectrogram") {
+            spectrogram = true;
+        } else if (arg == "--hrir" && i + 1 < argc) {
+            hrir_dir = argv[++i];
+        } else if (arg == "--chain" && i + 1 < argc) {
+            chain_definition = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            try {
+                thread_count = std::stoul(argv[++i]);
+            } catch (const std::exception&) {
+                std::print("[ERROR]: Invalid thread count: {}\n", argv[i]);
+                return -1;
+            }
+        } else {
+            // The cabinet's IR sits in samples/ but is not an input
+            bool directory = fs::is_directory(argv[i]);
+            for (const auto& file : collect_audio_files(argv[i])) {
+                std::error_code error;
+                if (directory && fs::equivalent(file, ir_path, error)) continue;
+                inputs.push_back(file);
+            }
+        }
+    }
+
+    if (inputs.empty()) {
+        std::print("[ERROR]: No input files\n");
+        return -1;
+    }
+
+    fs::path wisdom_path = root_dir / "fftw.wisdom";
+    FFT::load_wisdom(wisdom_path.string());
+
+    // Loaded once, shared read-only by every job
+    std::vector<std::string> chain = parse_chain(chain_definition);
+    ChainResources resources;
+    if (std::ranges::find(chain, "cabinet") != chain.end()) {
+        resources.cabinet_ir = std::make_shared<CabinetIR>(ir_path.string());
+    }
+    if (!hrir_dir.empty()) {
+        try {
+            resources.hrirs = std::make_shared<HRIRSet>(hrir_dir);
+        } catch (const std::exception& e) {
+            std::print("[ERROR]: {}\n", e.what());
+            return -1;
+        }
+    }
+
+    // Jobs share the cores, so only the calls made by the filters are checked
+    rt_check::enable(0);
+
+    auto start = std::chrono::steady_clock::now();
+    auto results = run_batch(
+        inputs, root_dir / "output" / "combination", chain, resources,
+        thread_count,
+        spectrogram ? std::optional(spectrogram_options) : std::nullopt);
+    double wall_seconds = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+
+    FFT::save_wisdom(wisdom_path.string());
+
+    double audio_seconds = 0;
+    int failed = 0;
+    for (const auto& result : results) {
+        if (!result.error.empty()) {
+            std::print("[ERROR]: {}: {}\n", result.input.string(),
+                       result.error);
+            failed++;
+            continue;
+        }
+
+        audio_seconds += result.audio_seconds;
+        std::print("[BATCH]: {}: {:.2f} s in {:.2f} s ({:.1f}x realtime)\n",
+                   result.input.string(), result.audio_seconds,
+                   result.wall_seconds, result.get_realtime_factor());
+    }
+
+    std::print(
+        "[BATCH]: {} files, {:.2f} s of audio in {:.2f} s on {} threads "
+        "({:.1f}x realtime)\n",
+        results.size() - failed, audio_seconds, wall_seconds,
+        ThreadPool::workers_for(thread_count),
+        wall_seconds > 0 ? audio_seconds / wall_seconds : 0);
+
+    if (!rt_check::report()) failed++;
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// AudioProcessor --sweep <file> --param filter.name=start:stop:step...
+//                [--chain a,b,c] [--threads N]
+// Renders every point of the parameter grid into output/{filter}/...
+// Without --chain the chain is made of the swept filters, in order.
+static auto run_sweep_command(int argc, char** argv, const fs::path& root_dir)
+    -> int {
+    fs::path input;
+    std::vector<std::string> chain;
+    std::vector<SweepParam> params;
+    size_t thread_count = std::thread::hardware_concurrency();
+    std::string hrir_dir;
+
+    try {
+        for (int i = 2; i < argc; ++i) {
+            std::string_view arg = argv[i];
+            if (arg == "--chain" && i + 1 < argc) {
+                chain = parse_chain(argv[++i]);
+            } else if (arg == "--hrir" && i + 1 < argc) {
+                hrir_dir = argv[++i];
+            } else if (arg == "--param" && i + 1 < argc) {
+                params.push_back(parse_sweep_param(argv[++i]));
+            } else if (arg == "--threads" && i + 1 < argc) {
+                thread_count = std::stoul(argv[++i]);
+            } else {
+                input = argv[i];
+            }
+        }
+    } catch (const std::exception& e) {
+        std::print("[ERROR]: {}\n", e.what());
+        return -1;
+    }
+
+    if (input.empty()) {
+        std::print("[ERROR]: No input file\n");
+        return -1;
+    }
+
+    if (chain.empty()) {
+        for (const auto& param : params) {
+            if (std::ranges::find(chain, param.filter) == chain.end()) {
+                chain.push_back(param.filter);
+            }
+        }
+    }
+
+    fs::path wisdom_path = root_dir / "fftw.wisdom";
+    FFT::load_wisdom(wisdom_path.string());
+
+    ChainResources resources;
+    if (std::ranges::find(chain, "cabinet") != chain.end()) {
+        resources.cabinet_ir = std::make_shared<CabinetIR>(
+            (root_dir / "samples" / "ir.wav").string());
+    }
+    if (!hrir_dir.empty()) {
+        try {
+            resources.hrirs = std::make_shared<HRIRSet>(hrir_dir);
+        } catch (const std::exception& e) {
+            std::print("[ERROR]: {}\n", e.what());
+            return -1;
+        }
+    }
+
+    std::vector<SweepResult> results;
+    auto start = std::chrono::steady_clock::now();
+    try {
+        results = run_sweep(input, root_dir / "output", chain, params,
+                            resources, thread_count);
+    } catch (const std::exception& e) {
+        std::print("[ERROR]: {}\n", e.what());
+        return -1;
+    }
+    double wall_seconds = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+
+    FFT::save_wisdom(wisdom_path.string());
+
+    int failed = 0;
+    for (const auto& result : results) {
+        if (!result.error.empty()) {
+            std::print("[ERROR]: {}: {}\n", result.output.string(),
+                       result.error);
+            failed++;
+            continue;
+        }
+        std::print("[SWEEP]: {}\n", result.output.string());
+    }
+
+    std::print("[SWEEP]: {} renders in {:.2f} s on {} threads\n",
+               results.size() - failed, wall_seconds,
+               ThreadPool::workers_for(thread_count));
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+auto main(int argc, char** argv) -> int {
     fs::path root_dir = fs::path(__FILE__).parent_path().parent_path();
 
+    // AudioProcessor --trace <file.json> [command...]
+    // Records the time spent in every filter and file access, see trace.h
+    if (argc > 2 && std::string_view(argv[1]) == "--trace") {
+        trace::start(argv[2]);
+        trace::set_thread_name("main");
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+
+    if (argc > 1 && std::string_view(argv[1]) == "--batch") {
+        return run_batch_command(argc, argv, root_dir);
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--sweep") {
+        return run_sweep_command(argc, argv, root_dir);
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--spectrogram") {
+        return run_spectrogram_command(argc, argv, root_dir);
+    }
+
     // Define params for i/o paths
     std::string audio_name = "crawling_scream";
     std::string audio_file_name = "audio.wav";
@@ -30,8 +370,11 @@ auto main() -> int {
     fs::path audio_in_path =
         root_dir / "samples" / audio_name / audio_file_name;
 
+    // Plans measured on previous runs, saved again once the chain is built
+    fs::path wisdom_path = root_dir / "fftw.wisdom";
+    FFT::load_wisdom(wisdom_path.string());
+
     AudioFileHandler fh;
-    const uint8_t out_channel_count = 0;
 
     if (!fh.open_read(audio_in_path.string())) {
         std::print("[ERROR]: Failed to open file {}\n", audio_in_path.string());
@@ -42,14 +385,24 @@ auto main() -> int {
     float sample_rate = fh.get_sample_rate();
 
     const size_t FRAMES_COUNT = 4096;
-    std::vector<AMPFilter*> filters;
 
-    filters.push_back(new BitcrusherFilter(channels, 8, 8));
-    filters.push_back(new CrybabyEffect(channels, sample_rate));
-    filters.push_back(new Overdrive(1000.0f, sample_rate, channels));
-    filters.push_back(new PitchShifter(1.5, sample_rate, channels));
-    filters.push_back(new CabinetConvolver("../samples/ir.wav", FRAMES_COUNT));
-    filters.push_back(new BinauralPanner(channels, sample_rate));
+    // Every stage runs on its own thread, the Overdrive solver and the cabinet
+    // convolution being the most expensive ones
+    std::vector<std::vector<AMPFilter*>> stages = {
+        {new BitcrusherFilter(channels, 8, 8),
+         new CrybabyEffect(channels, sample_rate)},
+        {new Overdrive(1000.0f, sample_rate, channels)},
+        {new PitchShifter(1.5, sample_rate, channels)},
+        {new CabinetConvolver("../samples/ir.wav"),
+         new BinauralPanner(channels, sample_rate)},
+    };
+
+    const uint8_t out_channel_count = stages.back().back()->get_out_channels();
+
+    if (!FFT::save_wisdom(wisdom_path.string())) {
+        std::print("[WARN]: Failed to save FFTW wisdom to {}\n",
+                   wisdom_path.string());
+    }
 
     // Define output file and create output directory
     fs::path audio_out_path =
@@ -63,26 +416,53 @@ auto main() -> int {
     }
     std::print("[DEBUG]: File opened: {}\n", audio_out_path.string());
 
-    size_t read_count = 0;
-    std::vector<float> input_buffer(FRAMES_COUNT * channels);
-    while ((read_count = fh.read_frames(input_buffer.data(), FRAMES_COUNT)) >
-           0) {
-        std::print("[DBG]: Read: {}\n", read_count);
+    // Decoding and encoding overlap with the pipeline
+    fh.start_streaming(FRAMES_COUNT);
 
-        std::vector<float> process_buffer(
-            input_buffer.begin(),
-            input_buffer.begin() + (read_count * channels));
+    rt_check::enable(sample_rate);
 
-        for (auto filter : filters) {
-            process_buffer = filter->apply(process_buffer);
-        }
+    {
+        Pipeline pipeline(stages, channels, FRAMES_COUNT);
+
+        size_t in_flight = 0;
+        bool end_of_file = false;
+        while (!end_of_file || in_flight > 0) {
+            PipelineBlock* block =
+                end_of_file ? nullptr : pipeline.try_acquire();
+
+            if (block) {
+                size_t read_count = fh.read_frames(block->input());
+                if (read_count == 0) {
+                    end_of_file = true;
+                    pipeline.release(block);
+                    continue;
+                }
 
-        size_t write_count = fh.write_frames(process_buffer.data(), read_count);
+                block->frames = read_count;
+                pipeline.submit(block);
+                in_flight++;
+                continue;
+            }
 
-        std::print("[DBG]: Wrote: {}\n", write_count);
+            // Every block is in flight (or the input is over), drain one
+            block = pipeline.receive();
+            fh.write_frames(block->output());
+            pipeline.release(block);
+            in_flight--;
+        }
+    }  // The pipeline's workers are joined here
+
+    bool written = fh.close(false);
+    if (!written) {
+        std::print("[ERROR]: Failed to write file {}\n",
+                   audio_out_path.string());
     }
 
-    for (auto f : filters) delete f;
+    bool rt_safe = rt_check::report();
+
+    for (const auto& stage : stages) {
+        for (auto f : stage) delete f;
+    }
 
-    return EXIT_SUCCESS;
+    return rt_safe && written ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -2,44 +2,63 @@
 
 #include <cmath>
 #include <filesystem>
+#include <format>
 #include <vector>
 
-Overdrive::Overdrive(float resistance, float sr, int channels)
-    : R_series(resistance), sample_rate(sr), num_channels(channels) {
+Overdrive::Overdrive(float resistance, float sr, int channels,
+                     ScatteringMode mode)
+    : R_series(resistance),
+      sample_rate(sr),
+      num_channels(channels),
+      mode(mode) {
     a_prev.resize(num_channels, 0.0f);
+
+    if (mode == ScatteringMode::table) table = DiodeTable::shared();
 }
 
-auto Overdrive::apply(const std::vector<float>& input) -> std::vector<float> {
-    std::vector<float> output = input;
+template <typename Scattering>
+auto Overdrive::process_with(ConstAudioView input, AudioView output,
+                             Scattering scatter) -> void {
+    // Channels are independent, each one keeps its reflected wave in a
+    // register for the whole block
+    for (int c = 0; c < num_channels; ++c) {
+        auto in = input.channel(c);
+        auto out = output.channel(c);
+        float a = a_prev[c];
 
-    for (size_t i = 0; i < output.size(); ++i) {
-        int current_channel = i % num_channels;
-        float voltageIn = output[i];
+        for (size_t i = 0; i < in.size(); ++i) {
+            // incident wave
+            float a_in = 2.0f * in[i] - a;
+            float b_out = scatter(a_in);
 
-        // incident wave
-        float a_in = 2.0f * voltageIn - a_prev[current_channel];
-        float b_out = scattering(a_in);
+            a = b_out;
 
-        a_prev[current_channel] = b_out;
+            // back to voltage
+            out[i] = (a_in + b_out) * 0.5f;
+        }
 
-        // back to voltage
-        output[i] = (a_in + b_out) * 0.5f;
+        a_prev[c] = a;
     }
+}
 
-    return output;
+auto Overdrive::process(ConstAudioView input, AudioView output) -> void {
+    if (mode == ScatteringMode::table) {
+        const DiodeTable& diodes = *table;
+        process_with(input, output,
+                     [&diodes](float a) { return diodes.lookup(a); });
+    } else {
+        process_with(input, output, [](float a) { return scattering(a); });
+    }
 }
 
 auto Overdrive::scattering(float a_in) -> float {
-    // Is: Saturation current
-    // Vt: Thermal voltage (~26mV at room temp)
-    constexpr float Is = 1e-9f;
-    constexpr float Vt = 0.02585f;
-    constexpr float R = 10000.0f;
+    using diode::R;
+    using diode::Vt;
 
     float v = a_in * 0.5f;
     for (int k = 0; k < 10; ++k) {
         // I = Is * (exp(v/Vt) - 1)
-        float current_Is = (v >= 0) ? 1e-9f : 5e-8f;
+        float current_Is = (v >= 0) ? diode::Is_forward : diode::Is_reverse;
         float exp_val = std::exp(v / Vt);
         float i_diode = current_Is * (exp_val - 1.0f);
 
@@ -66,7 +85,8 @@ auto Overdrive::get_filter_name() -> std::string { return "overdrive"; }
 
 auto Overdrive::get_output_dir(const std::string& audio_name) -> std::string {
     namespace fs = std::filesystem;
-    std::string params_str = "default-params";
+    std::string params_str = std::format("{:.2f}", R_series);
+    if (mode == ScatteringMode::table) params_str += "_table";
 
     fs::path audio_out_path =
         fs::path(get_filter_name()) / audio_name / params_str;
@@ -1,23 +1,41 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include "amp_filter.h"
+#include "diode_table.h"
+
+// newton: solves the diode equation every sample (exact)
+// table: looks the diode's response up in the shared DiodeTable
+enum class ScatteringMode { newton = 0, table = 1 };
 
 class Overdrive : public AMPFilter {
    public:
-    Overdrive(float resistance, float sr, int channels = 1);
+    Overdrive(float resistance, float sr, int channels = 1,
+              ScatteringMode mode = ScatteringMode::newton);
 
-    auto apply(const std::vector<float>& input) -> std::vector<float> override;
+    auto process(ConstAudioView input, AudioView output) -> void override;
+    auto get_in_channels() -> int override { return num_channels; }
     auto get_output_dir(const std::string& audio_name) -> std::string override;
     auto get_filter_name() -> std::string override;
 
+    // Reflected wave of the diode pair for the incident wave `a`, solved with
+    // Newton's method (the "newton" mode and the DiodeTable reference)
+    static auto scattering(float a) -> float;
+
    private:
-    auto scattering(float a) -> float;
+    template <typename Scattering>
+    auto process_with(ConstAudioView input, AudioView output,
+                      Scattering scatter) -> void;
 
     float R_series;
     float sample_rate;
     int num_channels;
+    ScatteringMode mode;
+
+    // Table mode only, shared by every Overdrive
+    std::shared_ptr<const DiodeTable> table;
 
     std::vector<float> a_prev;
 };
@@ -0,0 +1,198 @@
+#include "oversampler.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+// Taps of the octave next to the base rate, which has to be steep, and of the
+// octaves above it, which only need to reject the images of the first one
+constexpr int FIRST_TAPS = 47;
+constexpr int OTHER_TAPS = 23;
+
+// ~80 dB of stop band attenuation
+constexpr double KAISER_BETA = 8.0;
+
+// Modified Bessel function of the first kind, order 0 (power series)
+auto bessel_i0(double x) -> double {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 50; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+}  // namespace
+
+HalfbandStage::HalfbandStage(int taps) : taps(taps) {
+    if (taps < 3 || taps % 4 != 3) {
+        throw std::invalid_argument("HalfbandStage: taps must be 4k + 3");
+    }
+
+    // Kaiser windowed sinc with its cutoff at a quarter of the sample rate.
+    // The outer taps are the odd distances from the center.
+    int center = (taps - 1) / 2;
+    double sum = 0;
+    for (int n = 0; n < taps; n += 2) {
+        double d = n - center;
+        double ratio = 2.0 * n / (taps - 1) - 1.0;
+        double window = bessel_i0(KAISER_BETA * std::sqrt(1.0 - ratio * ratio)) /
+                        bessel_i0(KAISER_BETA);
+
+        double tap = std::sin(std::numbers::pi * d / 2.0) /
+                     (std::numbers::pi * d) * window;
+        coefficients.push_back((float)tap);
+        sum += tap;
+    }
+
+    // The center tap is 0.5, the outer ones make up the other half of the
+    // unity DC gain
+    for (auto& c : coefficients) c = (float)(c * 0.5 / sum);
+
+    history.resize(2 * coefficients.size());
+    delay_line.resize((center + 1) / 2);
+    reset();
+}
+
+auto HalfbandStage::reset() -> void {
+    std::fill(history.begin(), history.end(), 0.0f);
+    std::fill(delay_line.begin(), delay_line.end(), 0.0f);
+    history_pos = 0;
+    delay_pos = 0;
+}
+
+auto HalfbandStage::convolve(float sample) -> float {
+    const int size = coefficients.size();
+    history[history_pos] = sample;
+    history[history_pos + size] = sample;
+
+    // Oldest to newest. The taps are symmetric, so their order doesn't matter.
+    const float* window = history.data() + history_pos + 1;
+    float acc = 0.0f;
+    for (int k = 0; k < size; ++k) acc += coefficients[k] * window[k];
+
+    return acc;
+}
+
+auto HalfbandStage::upsample(std::span<const float> input,
+                             std::span<float> output) -> void {
+    const int size = coefficients.size();
+
+    // The center tap branch: the input from (center - 1) / 2 samples ago
+    const int center_age = ((taps - 1) / 2 - 1) / 2;
+
+    for (size_t n = 0; n < input.size(); ++n) {
+        // Zero stuffing halves the energy, both branches get a gain of 2
+        output[2 * n] = 2.0f * convolve(input[n]);
+        output[2 * n + 1] = history[history_pos + size - center_age];
+
+        history_pos = (history_pos + 1) % size;
+    }
+}
+
+auto HalfbandStage::downsample(std::span<const float> input,
+                               std::span<float> output) -> void {
+    const int size = coefficients.size();
+    const int delay_size = delay_line.size();
+
+    for (size_t n = 0; n < output.size(); ++n) {
+        // Even samples go through the outer taps, odd ones through the center
+        float acc = convolve(input[2 * n]);
+        history_pos = (history_pos + 1) % size;
+
+        output[n] = acc + 0.5f * delay_line[delay_pos];
+        delay_line[delay_pos] = input[2 * n + 1];
+        delay_pos = (delay_pos + 1) % delay_size;
+    }
+}
+
+Oversampler::Oversampler(std::unique_ptr<AMPFilter> filter, int factor)
+    : filter(std::move(filter)), factor(factor) {
+    if (factor != 2 && factor != 4 && factor != 8) {
+        throw std::invalid_argument("Oversampler: factor must be 2, 4 or 8");
+    }
+
+    octaves = std::countr_zero((unsigned)factor);
+    in_channels = this->filter->get_in_channels();
+    out_channels = this->filter->get_out_channels();
+
+    auto make_stages = [&](int channels) {
+        std::vector<std::vector<HalfbandStage>> stages(channels);
+        for (auto& channel : stages) {
+            for (int octave = 0; octave < octaves; ++octave) {
+                channel.emplace_back(octave == 0 ? FIRST_TAPS : OTHER_TAPS);
+            }
+        }
+        return stages;
+    };
+    up = make_stages(in_channels);
+    down = make_stages(out_channels);
+
+    // Round trip delay at the highest rate: every stage delays both ways
+    int delay = this->filter->get_latency();
+    for (int octave = 0; octave < octaves; ++octave) {
+        delay += 2 * up[0][octave].get_delay() << (octaves - 1 - octave);
+    }
+    padding = (factor - delay % factor) % factor;
+    latency = (delay + padding) / factor;
+
+    padding_lines.assign(in_channels, std::vector<float>(padding, 0.0f));
+
+    planar_a.resize(CHUNK_FRAMES * factor);
+    planar_b.resize(CHUNK_FRAMES * factor);
+    fast_in.resize(in_channels, CHUNK_FRAMES * factor);
+    fast_out.resize(out_channels, CHUNK_FRAMES * factor);
+}
+
+auto Oversampler::process(ConstAudioView input, AudioView output) -> void {
+    size_t frame_count = input.get_frames();
+
+    for (size_t start = 0; start < frame_count; start += CHUNK_FRAMES) {
+        size_t frames = std::min(CHUNK_FRAMES, frame_count - start);
+        size_t fast_frames = frames * factor;
+
+        for (int ch = 0; ch < in_channels; ++ch) {
+            // The first stage reads the channel where it is
+            std::span<const float> source =
+                input.channel(ch).subspan(start, frames);
+            for (auto& stage : up[ch]) {
+                stage.upsample(source,
+                               std::span(planar_b.data(), 2 * source.size()));
+                std::swap(planar_a, planar_b);
+                source = std::span(planar_a.data(), 2 * source.size());
+            }
+
+            float* fast = fast_in.channel(ch);
+            int pos = padding_pos;
+            for (size_t i = 0; i < fast_frames; ++i) {
+                float sample = planar_a[i];
+                if (padding > 0) {
+                    std::swap(sample, padding_lines[ch][pos]);
+                    pos = (pos + 1) % padding;
+                }
+                fast[i] = sample;
+            }
+        }
+        if (padding > 0) padding_pos = (padding_pos + fast_frames) % padding;
+
+        filter->process(fast_in.view(in_channels, fast_frames),
+                        fast_out.view(out_channels, fast_frames));
+
+        for (int ch = 0; ch < out_channels; ++ch) {
+            std::span<const float> source(fast_out.channel(ch), fast_frames);
+            for (int octave = octaves - 1; octave >= 0; --octave) {
+                down[ch][octave].downsample(
+                    source, std::span(planar_b.data(), source.size() / 2));
+                std::swap(planar_a, planar_b);
+                source = std::span(planar_a.data(), source.size() / 2);
+            }
+
+            std::copy_n(planar_a.data(), frames,
+                        output.channel(ch).subspan(start).data());
+        }
+    }
+}
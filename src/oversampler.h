@@ -0,0 +1,103 @@
+#pragma once
+
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "amp_filter.h"
+
+// One channel of a linear phase halfband FIR, used as a 2x interpolator or
+// decimator. Every other tap of a halfband filter is zero, except for the
+// center one, so both directions only convolve the non zero (outer) taps with
+// the samples of one polyphase branch, while the other branch is a plain
+// delay. The branch history is kept twice in a row, so the convolution always
+// reads one contiguous window and vectorizes.
+class HalfbandStage {
+   public:
+    // taps = 4 * k + 3, for an odd center delay
+    explicit HalfbandStage(int taps);
+
+    // Writes 2 * input.size() samples into `output`
+    auto upsample(std::span<const float> input, std::span<float> output)
+        -> void;
+
+    // Reads 2 * output.size() samples from `input`
+    auto downsample(std::span<const float> input, std::span<float> output)
+        -> void;
+
+    // Group delay in samples of the higher rate
+    auto get_delay() const -> int { return (taps - 1) / 2; }
+
+    auto reset() -> void;
+
+   private:
+    // Pushes `sample` into the branch history, returns the dot product of the
+    // outer taps with the updated window
+    auto convolve(float sample) -> float;
+
+    int taps;
+
+    // Outer taps h[0], h[2], ... h[taps - 1]
+    std::vector<float> coefficients;
+
+    // Last coefficients.size() samples of the convolved branch, twice
+    std::vector<float> history;
+    int history_pos = 0;
+
+    // Samples of the delayed branch (decimator only)
+    std::vector<float> delay_line;
+    int delay_pos = 0;
+};
+
+// Runs a filter at 2x, 4x or 8x the sample rate of the chain, so the harmonics
+// of nonlinear stages up to the oversampled Nyquist frequency don't alias back
+// into the audible band. Only the wrapped filter pays for the higher rate.
+//
+// Every octave goes through a halfband stage per channel in each direction,
+// the first (steepest) one with more taps than the others. The round trip is
+// padded at the highest rate to a whole amount of frames, reported with the
+// wrapped filter's own latency by get_latency().
+class Oversampler : public AMPFilter {
+   public:
+    // `filter` must be built for factor * the chain's sample rate
+    Oversampler(std::unique_ptr<AMPFilter> filter, int factor);
+
+    auto process(ConstAudioView input, AudioView output) -> void override;
+
+    auto get_in_channels() -> int override { return in_channels; }
+    auto get_out_channels() -> int override { return out_channels; }
+    auto get_latency() -> int override { return latency; }
+
+    auto get_output_dir(const std::string& audio_name) -> std::string override {
+        return filter->get_output_dir(audio_name) + "_x" +
+               std::to_string(factor);
+    }
+    auto get_filter_name() -> std::string override {
+        return filter->get_filter_name();
+    }
+
+   private:
+    // Base rate frames processed at once
+    static constexpr size_t CHUNK_FRAMES = 256;
+
+    std::unique_ptr<AMPFilter> filter;
+    int factor;
+    int octaves;
+    int in_channels, out_channels;
+    int latency;
+
+    // [channel][octave]
+    std::vector<std::vector<HalfbandStage>> up, down;
+
+    // Per channel padding delay at the highest rate
+    int padding;
+    std::vector<std::vector<float>> padding_lines;
+    int padding_pos = 0;
+
+    // Buffers of one channel at every rate (CHUNK_FRAMES * factor)
+    std::vector<float> planar_a, planar_b;
+
+    // Frames at the highest rate, in and out of the filter
+    AudioBuffer fast_in, fast_out;
+};
@@ -0,0 +1,152 @@
+#include "phase_vocoder.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <numbers>
+
+namespace {
+constexpr float TWO_PI = 2.0f * std::numbers::pi_v<float>;
+
+// Peaks below it are silence (or denormals)
+constexpr float MIN_PEAK_POWER = 1e-20f;
+
+// Into [-pi, pi]
+auto wrap_phase(float phase) -> float {
+    return phase - TWO_PI * std::round(phase / TWO_PI);
+}
+}  // namespace
+
+PhaseVocoder::PhaseVocoder(float pitch_factor, int fft_size)
+    : pitch_factor(pitch_factor),
+      fft_size(fft_size),
+      hop(fft_size / 4),
+      bins(fft_size / 2 + 1),
+      fft(fft_size) {
+    window.resize(fft_size);
+    for (int i = 0; i < fft_size; ++i) {
+        window[i] = 0.5f - 0.5f * std::cos(TWO_PI * i / fft_size);
+    }
+
+    // The squared windows of the 4 overlapping frames sum to a constant
+    float overlap_sum = 0.0f;
+    for (int i = 0; i < fft_size; i += hop) {
+        overlap_sum += window[i] * window[i];
+    }
+    output_gain = 1.0f / (fft_size * overlap_sum);
+
+    input_frames.resize(fft_size, 0.0f);
+    overlap.resize(fft_size, 0.0f);
+    ready.resize(hop, 0.0f);
+
+    analysis.resize(bins);
+    prev_analysis.resize(bins);
+    prev_synthesis.resize(bins);
+    power.resize(bins);
+    peaks.reserve(bins);
+}
+
+auto PhaseVocoder::fft_size_for(float sample_rate) -> int {
+    return (int)std::bit_ceil((unsigned)std::ceil(0.040f * sample_rate));
+}
+
+auto PhaseVocoder::process(std::span<const float> input,
+                           std::span<float> output) -> void {
+    size_t done = 0;
+    while (done < input.size()) {
+        size_t count = std::min<size_t>(input.size() - done, hop - fill);
+
+        // Input first, `output` may be `input`
+        std::copy_n(input.begin() + done, count,
+                    input_frames.begin() + fft_size - hop + fill);
+        std::copy_n(ready.begin() + fill, count, output.begin() + done);
+
+        fill += count;
+        done += count;
+
+        if (fill == hop) {
+            process_frame();
+            fill = 0;
+        }
+    }
+}
+
+auto PhaseVocoder::process_frame() -> void {
+    auto time = fft.real();
+    for (int i = 0; i < fft_size; ++i) time[i] = input_frames[i] * window[i];
+    fft.forward();
+
+    auto spectrum = fft.spectrum();
+    std::copy(spectrum.begin(), spectrum.end(), analysis.begin());
+    for (int k = 0; k < bins; ++k) power[k] = std::norm(analysis[k]);
+
+    // Local maxima over 2 bins on each side
+    peaks.clear();
+    for (int k = 0; k < bins; ++k) {
+        float p = power[k];
+        bool is_peak = p > MIN_PEAK_POWER;
+        for (int d = 1; d <= 2; ++d) {
+            if (k - d >= 0) is_peak = is_peak && p > power[k - d];
+            if (k + d < bins) is_peak = is_peak && p >= power[k + d];
+        }
+        if (is_peak) peaks.push_back(k);
+    }
+
+    std::fill(spectrum.begin(), spectrum.end(), std::complex<float>{0, 0});
+
+    for (size_t m = 0; m < peaks.size(); ++m) {
+        int peak = peaks[m];
+
+        // Region of influence: up to halfway to the neighbouring peaks
+        int low = m == 0 ? 0 : (peaks[m - 1] + peak) / 2 + 1;
+        int high = m + 1 == peaks.size() ? bins - 1
+                                         : (peak + peaks[m + 1]) / 2;
+
+        // True frequency of the peak, from the phase advance since the
+        // previous frame around the one of its bin. The bin's own when
+        // there was nothing to advance from.
+        float expected = TWO_PI * peak * hop / fft_size;
+        float deviation = 0.0f;
+        if (std::norm(prev_analysis[peak]) > MIN_PEAK_POWER) {
+            float advance =
+                std::arg(analysis[peak] * std::conj(prev_analysis[peak]));
+            deviation = wrap_phase(advance - expected);
+        }
+        float frequency = peak + deviation * fft_size / (TWO_PI * hop);
+
+        auto target = (int)std::lround(frequency * pitch_factor);
+        if (target < 0 || target >= bins) continue;
+        int shift = target - peak;
+
+        // Phase of the moved peak: the previous output at its bin advanced by
+        // the shifted frequency, or the input's when it just appeared
+        std::complex<float> unit_peak =
+            analysis[peak] / std::sqrt(power[peak]);
+        std::complex<float> phase = unit_peak;
+        float prev_magnitude = std::abs(prev_synthesis[target]);
+        if (prev_magnitude > 0.0f) {
+            phase = prev_synthesis[target] / prev_magnitude *
+                    std::polar(1.0f, (expected + deviation) * pitch_factor);
+        }
+        std::complex<float> rotation = phase * std::conj(unit_peak);
+
+        for (int k = std::max(low, -shift);
+             k <= std::min(high, bins - 1 - shift); ++k) {
+            spectrum[k + shift] += analysis[k] * rotation;
+        }
+    }
+
+    std::copy(spectrum.begin(), spectrum.end(), prev_synthesis.begin());
+    std::swap(analysis, prev_analysis);
+
+    fft.inverse();
+    for (int i = 0; i < fft_size; ++i) {
+        overlap[i] += time[i] * window[i] * output_gain;
+    }
+
+    std::copy_n(overlap.begin(), hop, ready.begin());
+    std::copy(overlap.begin() + hop, overlap.end(), overlap.begin());
+    std::fill(overlap.end() - hop, overlap.end(), 0.0f);
+    std::copy(input_frames.begin() + hop, input_frames.end(),
+              input_frames.begin());
+}
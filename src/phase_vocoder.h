@@ -0,0 +1,69 @@
+#pragma once
+
+#include <complex>
+#include <span>
+#include <vector>
+
+#include "fft.h"
+
+// Pitch shifting of a mono stream in the frequency domain, without changing
+// its duration: a phase vocoder with identity phase locking, after Laroche &
+// Dolson, "New phase-vocoder techniques for pitch-shifting, harmonizing and
+// other exotic effects" (1999).
+//
+// Every hop (a quarter of the FFT size) the last FFT size frames are
+// windowed and transformed. Each spectral peak is moved with the bins of its
+// region of influence to the peak's frequency times the pitch factor, all of
+// them rotated by the phase the moved peak must have to continue its
+// previous output. The bins of a partial keep their relative phases, so
+// chords stay clear of the phasing of a plain vocoder, and nothing is cut
+// into grains, so nothing flams.
+//
+// The cost is one forward and one inverse FFT plus a pass over the bins per
+// hop, whatever the signal. The FFT plan and every buffer are created once in
+// the constructor.
+class PhaseVocoder {
+   public:
+    // fft_size: power of two, the hop is fft_size / 4
+    PhaseVocoder(float pitch_factor, int fft_size);
+
+    // Frames between an input frame and its output
+    auto get_latency() const -> int { return fft_size; }
+
+    // `input` and `output` have the same size and may be the same span
+    auto process(std::span<const float> input, std::span<float> output)
+        -> void;
+
+    // Smallest power of two FFT size covering about 40 ms at `sample_rate`
+    static auto fft_size_for(float sample_rate) -> int;
+
+   private:
+    // Shifts the analysis window into `overlap`
+    auto process_frame() -> void;
+
+    float pitch_factor;
+    int fft_size;
+    int hop;
+    int bins;
+    FFT fft;
+
+    // Periodic Hann window, for both analysis and synthesis
+    std::vector<float> window;
+    // Compensates the FFT scaling and the overlapping squared windows
+    float output_gain;
+
+    // The last fft_size input frames, the newest `fill` of them not yet
+    // analyzed
+    std::vector<float> input_frames;
+    int fill = 0;
+
+    // Overlap-add of the synthesized frames, its first hop is being output
+    std::vector<float> overlap;
+    std::vector<float> ready;
+
+    // Spectra of the previous frame: analysis, to measure how the phase of
+    // every peak advanced, and synthesis, for the phases to continue
+    std::vector<std::complex<float>> analysis, prev_analysis, prev_synthesis;
+    std::vector<float> power;
+    std::vector<int> peaks;
+};
@@ -0,0 +1,77 @@
+#include "pipeline.h"
+
+#include <algorithm>
+#include <format>
+
+#include "filter_chain.h"
+#include "trace.h"
+
+Pipeline::Pipeline(std::vector<std::vector<AMPFilter*>> stages,
+                   int in_channels, size_t max_frames, size_t depth)
+    : stages(std::move(stages)), out_channels(in_channels), free_blocks(depth) {
+    int max_channels = in_channels;
+    for (const auto& stage : this->stages) {
+        max_channels = std::max(max_channels,
+                                get_max_channels(stage, max_channels));
+        if (!stage.empty()) out_channels = stage.back()->get_out_channels();
+    }
+
+    blocks.resize(depth);
+    for (auto& block : blocks) {
+        block.buffer.resize(max_channels, max_frames);
+        block.scratch.resize(max_channels, max_frames);
+        block.in_channels = in_channels;
+        block.out_channels = out_channels;
+        free_blocks.push(&block);
+    }
+
+    // Every queue can hold all the blocks plus the stop marker, so pushing
+    // never waits
+    for (size_t i = 0; i <= this->stages.size(); ++i) {
+        queues.push_back(
+            std::make_unique<SPSCQueue<PipelineBlock*>>(depth + 1));
+    }
+
+    for (size_t i = 0; i < this->stages.size(); ++i) {
+        workers.emplace_back([this, i] { run_stage(i); });
+    }
+}
+
+Pipeline::~Pipeline() {
+    queues.front()->push(nullptr);
+    workers.clear();  // joins
+}
+
+auto Pipeline::run_stage(size_t stage) -> void {
+    auto& in = *queues[stage];
+    auto& out = *queues[stage + 1];
+    trace::set_thread_name(std::format("stage {}", stage));
+
+    while (PipelineBlock* block = in.pop()) {
+        trace::Span span("stage", trace::Category::pipeline, block->frames);
+
+        AudioBuffer* other =
+            block->data == &block->buffer ? &block->scratch : &block->buffer;
+        block->data =
+            run_filters(stages[stage], block->data, other, block->frames);
+        out.push(block);
+    }
+
+    out.push(nullptr);
+}
+
+auto Pipeline::try_acquire() -> PipelineBlock* {
+    PipelineBlock* block = nullptr;
+    free_blocks.try_pop(block);
+    return block;
+}
+
+auto Pipeline::submit(PipelineBlock* block) -> void {
+    queues.front()->push(block);
+}
+
+auto Pipeline::receive() -> PipelineBlock* { return queues.back()->pop(); }
+
+auto Pipeline::release(PipelineBlock* block) -> void {
+    free_blocks.push(block);
+}
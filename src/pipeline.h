@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "amp_filter.h"
+#include "audio_buffer.h"
+#include "spsc_queue.h"
+
+// A block of planar audio travelling through the pipeline
+struct PipelineBlock {
+    // Two buffers of max_channels channels of max_frames frames, `data` is
+    // one of them and holds the current samples
+    AudioBuffer buffer, scratch;
+    AudioBuffer* data = nullptr;
+    size_t frames = 0;
+
+    // Channel counts of the pipeline's input and output
+    int in_channels = 0, out_channels = 0;
+
+    // Where to write the input (up to max_frames frames) before submitting
+    // the block
+    auto input() -> AudioView {
+        data = &buffer;
+        return buffer.view(in_channels, buffer.get_capacity());
+    }
+
+    // The processed frames of a received block
+    auto output() const -> ConstAudioView {
+        return std::as_const(*data).view(out_channels, frames);
+    }
+};
+
+// Runs groups of filters (stages) on dedicated worker threads.
+//
+// The stages are connected by SPSC queues and `depth` preallocated blocks
+// circulate through them, so the producer can be at most `depth` blocks ahead
+// of the consumer (backpressure) and nothing is allocated while running.
+// Every filter sees the same blocks in the same order as in a serial chain,
+// so the output is bit for bit identical.
+//
+// The producer side (try_acquire/submit) and the consumer side
+// (receive/release) may be driven by the same thread.
+class Pipeline {
+   public:
+    // Filters are not owned and must outlive the pipeline.
+    // in_channels: channel count of the submitted blocks
+    // max_frames: largest amount of frames in a submitted block
+    Pipeline(std::vector<std::vector<AMPFilter*>> stages, int in_channels,
+             size_t max_frames, size_t depth = 4);
+    ~Pipeline();
+
+    Pipeline(const Pipeline&) = delete;
+    auto operator=(const Pipeline&) -> Pipeline& = delete;
+
+    // A free block, or nullptr when all of them are in flight
+    auto try_acquire() -> PipelineBlock*;
+
+    // Hands a filled block (see PipelineBlock::input) to the first stage
+    auto submit(PipelineBlock* block) -> void;
+
+    // Waits for the next processed block, blocks leave in submission order
+    auto receive() -> PipelineBlock*;
+
+    // Gives a received block back to the pool
+    auto release(PipelineBlock* block) -> void;
+
+    auto get_out_channels() const -> int { return out_channels; }
+
+   private:
+    auto run_stage(size_t stage) -> void;
+
+    std::vector<std::vector<AMPFilter*>> stages;
+    int out_channels;
+
+    std::vector<PipelineBlock> blocks;
+    SPSCQueue<PipelineBlock*> free_blocks;
+
+    // queues[i] feeds stages[i], the last one feeds the consumer.
+    // A nullptr block tells the workers to stop.
+    std::vector<std::unique_ptr<SPSCQueue<PipelineBlock*>>> queues;
+    std::vector<std::jthread> workers;
+};
@@ -1,78 +1,118 @@
 #include "pitch_shifter.h"
 
+#include <algorithm>
+#include <array>
 #include <cmath>
 #include <filesystem>
+#include <format>
+#include <stdexcept>
 #include <vector>
 
-PitchShifter::PitchShifter(float pitch_factor, float sample_rate, int channels)
-    : pitch_factor(pitch_factor), channels(channels), cursor(0), phasor(0.0f) {
-    // used to reduce the buzz
-    grain_frames = static_cast<size_t>(0.050f * sample_rate);
+PitchShifter::PitchShifter(float pitch_factor, float sample_rate, int channels,
+                           bool vocoder, Interpolation interpolation)
+    : pitch_factor(pitch_factor),
+      channels(channels),
+      interpolation(interpolation),
+      // used to reduce the buzz
+      grain_frames(static_cast<size_t>(0.050f * sample_rate)),
+      phasor(0.0f) {
+    if (vocoder) {
+        if (interpolation != Interpolation::linear) {
+            throw std::invalid_argument(
+                "pitchshifter: the vocoder has no interpolation");
+        }
+        int fft_size = PhaseVocoder::fft_size_for(sample_rate);
+        vocoders.reserve(channels);
+        for (int c = 0; c < channels; ++c) {
+            vocoders.emplace_back(pitch_factor, fft_size);
+        }
+        return;
+    }
 
-    buff_size = grain_frames * 4;
-    buffer.resize(buff_size * channels, 0.0f);
+    // The taps read up to a grain plus the interpolator's minimum delay
+    delay_line = make_delay_line(interpolation, channels,
+                                 (int)grain_frames + 8, MAX_BLOCK);
 }
 
-auto PitchShifter::apply(const std::vector<float>& input)
-    -> std::vector<float> {
-    std::vector<float> output(input.size());
-    size_t frames = input.size() / channels;
+auto GrainTaps::compute(double& phasor, double phase_increment,
+                        float grain_frames, float min_delay, size_t count)
+    -> void {
+    double start = phasor;
+    // int frames and casts: size_t to double conversions and std::floor
+    // don't vectorize
+    for (int i = 0; i < (int)count; ++i) {
+        double phasor_a = start + i * phase_increment;
+        // keep phasor in [0.0, 1.0) range
+        phasor_a -= (int)phasor_a;
+        phasor_a += phasor_a < 0.0 ? 1.0 : 0.0;
+        double phasor_b = phasor_a + 0.5;
+        phasor_b -= phasor_b >= 1.0 ? 1.0 : 0.0;
 
-    // rate at which the delay time changes.
-    // if pitch == 1.0, rate is 0 (delay is constant).
-    // if pitch == 2.0, rate is negative (we catch up to the write head).
-    double phase_increment = (1.0f - pitch_factor) / grain_frames;
+        // how far back in the buffer to read
+        delay_a[i] = (float)(phasor_a * grain_frames) + min_delay;
+        delay_b[i] = (float)(phasor_b * grain_frames) + min_delay;
 
-    for (size_t i = 0; i < frames; ++i) {
-        for (int c = 0; c < channels; ++c) {
-            buffer[cursor * channels + c] = input[i * channels + c];
-        }
+        // triangle window: 1.0 at center (0.5), 0.0 at edges (0.0 and 1.0)
+        weight_a[i] = 1.0f - 2.0f * std::abs((float)phasor_a - 0.5f);
+        weight_b[i] = 1.0f - 2.0f * std::abs((float)phasor_b - 0.5f);
+    }
 
-        double phasor_a = phasor;
-        double phasor_b = phasor + 0.5f;
-        if (phasor_b >= 1.0f) phasor_b -= 1.0f;
+    double next = start + (double)count * phase_increment;
+    phasor = next - std::floor(next);
+}
 
-        // how far back in the buffer to read
-        auto delay_a = static_cast<float>(phasor_a * grain_frames);
-        auto delay_b = static_cast<float>(phasor_b * grain_frames);
+auto PitchShifter::get_latency() -> int {
+    if (!vocoders.empty()) return vocoders.front().get_latency();
+    return std::visit([](const auto& line) { return line.min_delay; },
+                      *delay_line);
+}
 
+auto PitchShifter::process(ConstAudioView input, AudioView output) -> void {
+    if (!vocoders.empty()) {
         for (int c = 0; c < channels; ++c) {
-            float sample_a = get_sample(cursor, delay_a, c);
-            float sample_b = get_sample(cursor, delay_b, c);
-
-            // triangle window: 1.0 at center (0.5), 0.0 at edges (0.0 and 1.0)
-            float weight_a = 1.0f - 2.0f * std::abs((float)phasor_a - 0.5f);
-            float weight_b = 1.0f - 2.0f * std::abs((float)phasor_b - 0.5f);
-
-            output[i * channels + c] =
-                (sample_a * weight_a) + (sample_b * weight_b);
+            vocoders[c].process(input.channel(c), output.channel(c));
         }
-
-        cursor = (cursor + 1) % buff_size;
-        phasor += phase_increment;
-
-        // keep phasor in [0.0, 1.0) range
-        if (phasor >= 1.0f) phasor -= 1.0f;
-        if (phasor < 0.0f) phasor += 1.0f;
+        return;
     }
 
-    return output;
-}
-
-auto PitchShifter::get_sample(size_t current_pos, float delay, int channel)
-    -> float {
-    float read_idx = static_cast<float>(current_pos) - delay;
-    while (read_idx < 0.0f) read_idx += buff_size;
-    while (read_idx >= buff_size) read_idx -= buff_size;
+    size_t frames = input.get_frames();
 
-    auto i1 = static_cast<size_t>(read_idx);
-    size_t i2 = (i1 + 1) % buff_size;
-    float frac = read_idx - i1;
-
-    float s1 = buffer[i1 * channels + channel];
-    float s2 = buffer[i2 * channels + channel];
+    // rate at which the delay time changes.
+    // if pitch == 1.0, rate is 0 (delay is constant).
+    // if pitch == 2.0, rate is negative (we catch up to the write head).
+    double phase_increment = (1.0f - pitch_factor) / grain_frames;
 
-    return s1 + frac * (s2 - s1);
+    GrainTaps trajectory;
+    alignas(32) std::array<float, MAX_BLOCK> sample_a, sample_b;
+
+    for (size_t start = 0; start < frames; start += MAX_BLOCK) {
+        size_t count = std::min(MAX_BLOCK, frames - start);
+
+        // Trajectories of the two taps, shared by every channel
+        trajectory.compute(phasor, phase_increment, (float)grain_frames,
+                     (float)get_latency(), count);
+
+        std::visit(
+            [&](auto& line) {
+                auto taps_a = std::span(sample_a).first(count);
+                auto taps_b = std::span(sample_b).first(count);
+                for (int c = 0; c < channels; ++c) {
+                    line.write(c, input.channel(c).subspan(start, count));
+                    line.read(c, std::span(trajectory.delay_a).first(count),
+                              taps_a);
+                    line.read(c, std::span(trajectory.delay_b).first(count),
+                              taps_b);
+
+                    auto out = output.channel(c).subspan(start, count);
+                    for (size_t i = 0; i < count; ++i) {
+                        out[i] = (taps_a[i] * trajectory.weight_a[i]) +
+                                 (taps_b[i] * trajectory.weight_b[i]);
+                    }
+                }
+                line.advance(count);
+            },
+            *delay_line);
+    }
 }
 
 auto PitchShifter::get_filter_name() -> std::string { return "pitchshifter"; }
@@ -80,7 +120,14 @@ auto PitchShifter::get_filter_name() -> std::string { return "pitchshifter"; }
 auto PitchShifter::get_output_dir(const std::string& audio_name)
     -> std::string {
     namespace fs = std::filesystem;
-    std::string params_str = "default-params";
+    std::string params_str = std::format("{:.2f}", pitch_factor);
+    if (!vocoders.empty()) {
+        params_str += "_vocoder";
+    } else if (interpolation == Interpolation::cubic) {
+        params_str += "_cubic";
+    } else if (interpolation == Interpolation::sinc) {
+        params_str += "_sinc";
+    }
 
     fs::path audio_out_path =
         fs::path(get_filter_name()) / audio_name / params_str;
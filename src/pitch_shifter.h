@@ -1,25 +1,59 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <optional>
 #include <vector>
 
 #include "amp_filter.h"
+#include "delay_line.h"
+#include "phase_vocoder.h"
+
+// Delays and triangle windows of the two taps of the delay line shifter over
+// a block, shared by PitchShifter and Harmonizer so they shift alike
+struct GrainTaps {
+    static constexpr size_t MAX_BLOCK = 256;
+
+    // Fills the first `count` frames from `phasor` and moves it past them.
+    // The phasor of every frame is computed from the block's first one,
+    // without a running sum the loop can't vectorize.
+    auto compute(double& phasor, double phase_increment, float grain_frames,
+                 float min_delay, size_t count) -> void;
+
+    alignas(32) std::array<float, MAX_BLOCK> delay_a, delay_b, weight_a,
+        weight_b;
+};
 
 class PitchShifter : public AMPFilter {
    public:
-    PitchShifter(float pitch_factor, float sample_rate, int channels);
-    auto apply(const std::vector<float>& input) -> std::vector<float> override;
+    // vocoder: shift every channel with a PhaseVocoder instead of the two
+    // tap delay line. Higher quality on chords, at the cost of its latency.
+    // interpolation: of the delay line's fractional taps. The higher orders
+    // keep the highs, and delay the output by a few frames. Throws
+    // std::invalid_argument if not linear with the vocoder, which has none.
+    PitchShifter(float pitch_factor, float sample_rate, int channels,
+                 bool vocoder = false,
+                 Interpolation interpolation = Interpolation::linear);
+    auto process(ConstAudioView input, AudioView output) -> void override;
+    auto get_in_channels() -> int override { return channels; }
+    auto get_latency() -> int override;
     auto get_output_dir(const std::string& audio_name) -> std::string override;
     auto get_filter_name() -> std::string override;
 
    private:
-    auto get_sample(size_t current_pos, float delay, int channel) -> float;
+    // Frames whose tap trajectories are computed at once
+    static constexpr size_t MAX_BLOCK = GrainTaps::MAX_BLOCK;
 
     float pitch_factor;
     int channels;
+    Interpolation interpolation;
     size_t grain_frames;
-    size_t buff_size;
 
-    std::vector<float> buffer;
-    size_t cursor;
+    // The input history of every channel, read by two taps. Not allocated
+    // with the vocoder.
+    std::optional<AnyDelayLine> delay_line;
     double phasor;
+
+    // Vocoder mode only, one per channel
+    std::vector<PhaseVocoder> vocoders;
 };
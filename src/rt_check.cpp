@@ -0,0 +1,375 @@
+#include "rt_check.h"
+
+#ifdef AMP_RT_CHECK
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <print>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <execinfo.h>
+#endif
+
+#include "amp_filter.h"
+
+namespace rt_check {
+namespace {
+enum class Kind { allocation, deallocation, blocking_call, iostream };
+
+auto to_string(Kind kind) -> const char* {
+    switch (kind) {
+        case Kind::allocation:
+            return "allocation";
+        case Kind::deallocation:
+            return "deallocation";
+        case Kind::blocking_call:
+            return "blocking call";
+        case Kind::iostream:
+            return "iostream";
+    }
+    return "";
+}
+
+struct Violation {
+    // A copy, the filter may be gone by the report (batch jobs)
+    std::string filter;
+    Kind kind;
+    const char* call;
+    size_t count;
+    std::vector<std::string> stack;
+};
+
+std::atomic<bool> enabled = false;
+std::atomic<float> block_sample_rate = 0;
+
+std::atomic<size_t> block_count = 0, overrun_count = 0;
+std::atomic<double> worst_load = 0;
+
+thread_local AMPFilter* current_filter = nullptr;
+
+// Set while recording, the recording itself allocates
+thread_local bool recording = false;
+
+auto violations_mutex() -> std::mutex& {
+    static std::mutex mutex;
+    return mutex;
+}
+
+auto violations() -> std::vector<Violation>& {
+    static std::vector<Violation> list;
+    return list;
+}
+
+auto capture_stack() -> std::vector<std::string> {
+    std::vector<std::string> stack;
+#if defined(__GLIBC__)
+    void* frames[32];
+    int count = backtrace(frames, 32);
+    char** symbols = backtrace_symbols(frames, count);
+    if (symbols) {
+        // Skips capture_stack() and record()
+        for (int i = 2; i < count; ++i) stack.emplace_back(symbols[i]);
+        free(symbols);
+    }
+#endif
+    return stack;
+}
+
+auto record(Kind kind, const char* call) -> void {
+    recording = true;
+
+    std::string filter = current_filter->get_filter_name();
+
+    std::lock_guard lock(violations_mutex());
+    bool found = false;
+    for (auto& violation : violations()) {
+        if (violation.filter == filter && violation.kind == kind &&
+            violation.call == call) {
+            violation.count++;
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        violations().push_back(
+            {std::move(filter), kind, call, 1, capture_stack()});
+    }
+
+    recording = false;
+}
+
+inline auto check(Kind kind, const char* call) -> void {
+    if (current_filter && !recording &&
+        enabled.load(std::memory_order_relaxed)) {
+        record(kind, call);
+    }
+}
+
+// Forwards to the original stream buffer, flagging writes from filters
+class CheckingStreambuf : public std::streambuf {
+   public:
+    explicit CheckingStreambuf(std::streambuf* target) : target(target) {}
+
+   protected:
+    auto overflow(int_type c) -> int_type override {
+        check(Kind::iostream, "std::ostream");
+        return traits_type::eq_int_type(c, traits_type::eof())
+                   ? traits_type::not_eof(c)
+                   : target->sputc(traits_type::to_char_type(c));
+    }
+
+    auto xsputn(const char* s, std::streamsize n) -> std::streamsize override {
+        check(Kind::iostream, "std::ostream");
+        return target->sputn(s, n);
+    }
+
+    auto sync() -> int override {
+        check(Kind::iostream, "std::ostream");
+        return target->pubsync();
+    }
+
+   private:
+    std::streambuf* target;
+};
+
+// The next definition of a libc symbol (ours shadow them)
+template <typename Function>
+auto next_symbol(Function& function, const char* name) -> Function {
+    if (!function) function = (Function)dlsym(RTLD_NEXT, name);
+    return function;
+}
+}  // namespace
+
+auto enable(float sample_rate) -> void {
+    block_sample_rate = sample_rate;
+
+    static bool streams_wrapped = false;
+    if (!streams_wrapped) {
+        static CheckingStreambuf out(std::cout.rdbuf());
+        static CheckingStreambuf err(std::cerr.rdbuf());
+        static CheckingStreambuf log(std::clog.rdbuf());
+        std::cout.rdbuf(&out);
+        std::cerr.rdbuf(&err);
+        std::clog.rdbuf(&log);
+        streams_wrapped = true;
+    }
+
+    enabled = true;
+}
+
+auto report() -> bool {
+    enabled = false;
+    std::lock_guard lock(violations_mutex());
+
+    for (const auto& violation : violations()) {
+        std::print("[RT]: {}: {} in {} ({} times)\n",
+                   violation.filter,
+                   to_string(violation.kind), violation.call, violation.count);
+        for (const auto& frame : violation.stack) {
+            std::print("[RT]:     {}\n", frame);
+        }
+    }
+
+    if (block_sample_rate > 0) {
+        std::print(
+            "[RT]: {} of {} blocks over their deadline, worst at {:.0f}% of "
+            "the block duration\n",
+            overrun_count.load(), block_count.load(), worst_load * 100.0);
+    }
+
+    return violations().empty() && overrun_count == 0;
+}
+
+FilterScope::FilterScope(AMPFilter* filter) : previous(current_filter) {
+    current_filter = filter;
+}
+
+FilterScope::~FilterScope() { current_filter = previous; }
+
+BlockScope::BlockScope(size_t frames)
+    : frames(frames), begin(std::chrono::steady_clock::now()) {}
+
+BlockScope::~BlockScope() {
+    float sample_rate = block_sample_rate.load(std::memory_order_relaxed);
+    if (!enabled.load(std::memory_order_relaxed) || sample_rate <= 0 ||
+        frames == 0) {
+        return;
+    }
+
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - begin)
+                         .count();
+    double load = seconds * sample_rate / frames;
+
+    block_count++;
+    if (load > 1.0) overrun_count++;
+
+    double worst = worst_load.load(std::memory_order_relaxed);
+    while (load > worst && !worst_load.compare_exchange_weak(worst, load)) {
+    }
+}
+}  // namespace rt_check
+
+using rt_check::check;
+using rt_check::Kind;
+using rt_check::next_symbol;
+
+// Heap. On glibc malloc itself is replaced, which also covers the C libraries
+// (FFTW, libsndfile); elsewhere only the C++ operators are.
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+
+void* malloc(size_t size) {
+    check(Kind::allocation, "malloc");
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    check(Kind::allocation, "calloc");
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    check(Kind::allocation, "realloc");
+    return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+    check(Kind::allocation, "posix_memalign");
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr ? 0 : ENOMEM;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    check(Kind::allocation, "aligned_alloc");
+    return __libc_memalign(alignment, size);
+}
+
+void free(void* ptr) {
+    if (ptr) check(Kind::deallocation, "free");
+    __libc_free(ptr);
+}
+}
+#else
+auto operator new(size_t size) -> void* {
+    check(Kind::allocation, "operator new");
+    if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+auto operator new[](size_t size) -> void* { return operator new(size); }
+
+auto operator new(size_t size, const std::nothrow_t&) noexcept -> void* {
+    check(Kind::allocation, "operator new");
+    return std::malloc(size ? size : 1);
+}
+
+auto operator new[](size_t size, const std::nothrow_t& tag) noexcept
+    -> void* {
+    return operator new(size, tag);
+}
+
+auto operator delete(void* ptr) noexcept -> void {
+    if (ptr) check(Kind::deallocation, "operator delete");
+    std::free(ptr);
+}
+
+auto operator delete[](void* ptr) noexcept -> void { operator delete(ptr); }
+
+auto operator delete(void* ptr, size_t) noexcept -> void {
+    operator delete(ptr);
+}
+
+auto operator delete[](void* ptr, size_t) noexcept -> void {
+    operator delete(ptr);
+}
+#endif
+
+// Blocking calls, forwarded to the next definition
+extern "C" {
+int pthread_mutex_lock(pthread_mutex_t* mutex) {
+    static int (*next)(pthread_mutex_t*) = nullptr;
+    check(Kind::blocking_call, "pthread_mutex_lock");
+    return next_symbol(next, "pthread_mutex_lock")(mutex);
+}
+
+int pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex) {
+    static int (*next)(pthread_cond_t*, pthread_mutex_t*) = nullptr;
+    check(Kind::blocking_call, "pthread_cond_wait");
+    return next_symbol(next, "pthread_cond_wait")(cond, mutex);
+}
+
+int sem_wait(sem_t* sem) {
+    static int (*next)(sem_t*) = nullptr;
+    check(Kind::blocking_call, "sem_wait");
+    return next_symbol(next, "sem_wait")(sem);
+}
+
+int nanosleep(const struct timespec* duration, struct timespec* remaining) {
+    static int (*next)(const struct timespec*, struct timespec*) = nullptr;
+    check(Kind::blocking_call, "nanosleep");
+    return next_symbol(next, "nanosleep")(duration, remaining);
+}
+
+int usleep(useconds_t usec) {
+    static int (*next)(useconds_t) = nullptr;
+    check(Kind::blocking_call, "usleep");
+    return next_symbol(next, "usleep")(usec);
+}
+
+ssize_t read(int fd, void* buffer, size_t count) {
+    static ssize_t (*next)(int, void*, size_t) = nullptr;
+    check(Kind::blocking_call, "read");
+    return next_symbol(next, "read")(fd, buffer, count);
+}
+
+ssize_t write(int fd, const void* buffer, size_t count) {
+    static ssize_t (*next)(int, const void*, size_t) = nullptr;
+    check(Kind::blocking_call, "write");
+    return next_symbol(next, "write")(fd, buffer, count);
+}
+
+int open(const char* path, int flags, ...) {
+    static int (*next)(const char*, int, ...) = nullptr;
+    check(Kind::blocking_call, "open");
+
+    // The mode is only passed when a file may be created
+    int mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, int);
+        va_end(args);
+    }
+    return next_symbol(next, "open")(path, flags, mode);
+}
+
+FILE* fopen(const char* path, const char* mode) {
+    static FILE* (*next)(const char*, const char*) = nullptr;
+    check(Kind::blocking_call, "fopen");
+    return next_symbol(next, "fopen")(path, mode);
+}
+}
+
+#endif
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+class AMPFilter;
+
+// Real-time safety checks for the processing path, compiled in with
+// -DAMP_RT_CHECK=ON (otherwise every call below is an empty inline).
+//
+// While a filter runs inside a FilterScope, the checker flags heap
+// allocations and deallocations, blocking calls (locks, sleeps, file I/O) and
+// writes to the std::cout/cerr/clog streams, recording the filter and the
+// call stack of the first occurrence. BlockScope counts the blocks whose
+// processing took longer than their own audio duration.
+namespace rt_check {
+#ifdef AMP_RT_CHECK
+
+// Starts checking. Blocks are measured against `sample_rate`, 0 disables the
+// deadline checks.
+auto enable(float sample_rate) -> void;
+
+// Prints every violation and the deadline statistics, returns true if the
+// chain ran clean
+auto report() -> bool;
+
+// Marks the calling thread as running `filter`
+class FilterScope {
+   public:
+    explicit FilterScope(AMPFilter* filter);
+    ~FilterScope();
+
+    FilterScope(const FilterScope&) = delete;
+    auto operator=(const FilterScope&) -> FilterScope& = delete;
+
+   private:
+    AMPFilter* previous;
+};
+
+// Processing of one block of `frames` frames
+class BlockScope {
+   public:
+    explicit BlockScope(size_t frames);
+    ~BlockScope();
+
+    BlockScope(const BlockScope&) = delete;
+    auto operator=(const BlockScope&) -> BlockScope& = delete;
+
+   private:
+    size_t frames;
+    std::chrono::steady_clock::time_point begin;
+};
+
+#else
+
+inline auto enable(float) -> void {}
+inline auto report() -> bool { return true; }
+
+class FilterScope {
+   public:
+    explicit FilterScope(AMPFilter*) {}
+};
+
+class BlockScope {
+   public:
+    explicit BlockScope(size_t) {}
+};
+
+#endif
+}  // namespace rt_check
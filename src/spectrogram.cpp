@@ -0,0 +1,194 @@
+#include "spectrogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <format>
+#include <fstream>
+#include <numbers>
+#include <stdexcept>
+
+#include "audio_handler.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+// Keeps silence out of log10(0)
+constexpr float POWER_FLOOR = 1e-10f;
+
+auto make_window(WindowType type, int size) -> std::vector<float> {
+    std::vector<float> window(size, 1.0f);
+    // Periodic windows, as used for spectral analysis
+    for (int i = 0; i < size; ++i) {
+        float phase = 2.0f * std::numbers::pi_v<float> * i / size;
+        switch (type) {
+            case WindowType::hann:
+                window[i] = 0.5f - 0.5f * std::cos(phase);
+                break;
+            case WindowType::hamming:
+                window[i] = 0.54f - 0.46f * std::cos(phase);
+                break;
+            case WindowType::blackman:
+                window[i] = 0.42f - 0.5f * std::cos(phase) +
+                            0.08f * std::cos(2.0f * phase);
+                break;
+            case WindowType::rectangular:
+                break;
+        }
+    }
+    return window;
+}
+
+auto check_options(const SpectrogramOptions& options)
+    -> const SpectrogramOptions& {
+    if (options.window_size < 2 || options.window_size % 2 != 0) {
+        throw std::invalid_argument(
+            "Spectrogram window size must be even and at least 2");
+    }
+    if (options.hop < 1) {
+        throw std::invalid_argument("Spectrogram hop must be positive");
+    }
+    return options;
+}
+}  // namespace
+
+auto parse_window_type(const std::string& name) -> std::optional<WindowType> {
+    if (name == "hann") return WindowType::hann;
+    if (name == "hamming") return WindowType::hamming;
+    if (name == "blackman") return WindowType::blackman;
+    if (name == "rectangular") return WindowType::rectangular;
+    return std::nullopt;
+}
+
+Spectrogram::Spectrogram(int channels, float sample_rate,
+                         const SpectrogramOptions& options)
+    : channels(channels),
+      sample_rate(sample_rate),
+      // Checked before the FFT is planned for the window size
+      options(check_options(options)),
+      window(make_window(options.window, options.window_size)),
+      fft(options.window_size),
+      history(channels),
+      db(channels) {
+    float energy = 0;
+    for (float w : window) energy += w * w;
+    scale = 1.0f / (sample_rate * energy);
+}
+
+auto Spectrogram::push(ConstAudioView audio) -> void {
+    size_t frames = audio.get_frames();
+    size_t history_end = history_start + history.front().size();
+    size_t skip = history_end > pushed
+                      ? std::min(frames, history_end - pushed)
+                      : 0;
+
+    for (int c = 0; c < channels; ++c) {
+        auto samples = audio.channel(c);
+        history[c].insert(history[c].end(), samples.begin() + skip,
+                          samples.end());
+    }
+    pushed += frames;
+
+    while (history.front().size() >= (size_t)options.window_size) {
+        transform_column();
+    }
+}
+
+auto Spectrogram::finish() -> void {
+    size_t window_size = options.window_size;
+    size_t hop = options.hop;
+
+    // The last column may be zero padded, a short signal still gets one
+    size_t total =
+        pushed > window_size ? (pushed - window_size + hop - 1) / hop + 1 : 1;
+    while (columns < total) transform_column();
+}
+
+auto Spectrogram::transform_column() -> void {
+    auto time = fft.real();
+    auto freq = fft.spectrum();
+    int bins = get_bins();
+    size_t hop = options.hop;
+
+    for (int c = 0; c < channels; ++c) {
+        auto& samples = history[c];
+        for (size_t i = 0; i < time.size(); ++i) {
+            time[i] = i < samples.size() ? samples[i] * window[i] : 0;
+        }
+
+        fft.forward();
+
+        db[c].resize((columns + 1) * bins);
+        float* out = db[c].data() + columns * bins;
+        for (int bin = 0; bin < bins; ++bin) {
+            float power = std::norm(freq[bin]) * scale;
+            // One sided spectrum: every bin but DC and Nyquist stands for two
+            if (bin > 0 && bin < bins - 1) power *= 2.0f;
+            out[bin] = 10.0f * std::log10(power + POWER_FLOOR);
+        }
+
+        samples.erase(samples.begin(),
+                      samples.begin() + std::min(hop, samples.size()));
+    }
+
+    history_start += hop;
+    columns++;
+}
+
+auto Spectrogram::write_images(const fs::path& dir) const
+    -> std::vector<fs::path> {
+    std::vector<fs::path> paths;
+    int bins = get_bins();
+
+    for (int c = 0; c < channels; ++c) {
+        fs::path path = channels == 1 ? dir / "spect_mono.pgm"
+                                      : dir / std::format("spect_ch_{}.pgm", c);
+
+        const auto& values = db[c];
+        float peak = values.empty()
+                         ? 0.0f
+                         : *std::max_element(values.begin(), values.end());
+        float floor = peak - options.range_db;
+
+        std::vector<unsigned char> pixels(columns * bins);
+        for (size_t column = 0; column < columns; ++column) {
+            for (int bin = 0; bin < bins; ++bin) {
+                float level = (values[column * bins + bin] - floor) /
+                              options.range_db;
+                level = std::clamp(level, 0.0f, 1.0f);
+                // Top row is the highest bin
+                pixels[(bins - 1 - bin) * columns + column] =
+                    (unsigned char)std::lround(level * 255.0f);
+            }
+        }
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file) throw std::runtime_error("Failed to write " + path.string());
+        file << std::format("P5\n{} {}\n255\n", columns, bins);
+        file.write(reinterpret_cast<const char*>(pixels.data()),
+                   pixels.size());
+        paths.push_back(path);
+    }
+    return paths;
+}
+
+auto write_file_spectrogram(const fs::path& path,
+                            const SpectrogramOptions& options)
+    -> std::vector<fs::path> {
+    AudioFileHandler fh;
+    if (!fh.open_read(path.string())) {
+        throw std::runtime_error("Failed to open " + path.string());
+    }
+
+    int channels = fh.get_channels();
+    Spectrogram spectrogram(channels, fh.get_sample_rate(), options);
+
+    constexpr size_t FRAMES_COUNT = 65536;
+    AudioBuffer buffer(channels, FRAMES_COUNT);
+    while (size_t read_count = fh.read_frames(buffer.view())) {
+        spectrogram.push(std::as_const(buffer).view(channels, read_count));
+    }
+
+    spectrogram.finish();
+    return spectrogram.write_images(path.parent_path());
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "audio_buffer.h"
+#include "fft.h"
+
+enum class WindowType { hann, hamming, blackman, rectangular };
+
+// Parses "hann", "hamming", "blackman" or "rectangular"
+auto parse_window_type(const std::string& name) -> std::optional<WindowType>;
+
+struct SpectrogramOptions {
+    int window_size = 1024;
+    int hop = 256;
+    WindowType window = WindowType::hann;
+
+    // Intensities more than `range_db` under a channel's peak are black
+    float range_db = 100.0f;
+};
+
+// Power spectrogram of each channel of a signal, in dB, written as 8 bit
+// grayscale PGM images (low frequencies at the bottom, time to the right).
+//
+// The audio is fed with push(), so a render can feed it block by block
+// instead of reading its output again. A column is transformed as soon as its
+// window is complete, only the audio of the next window is kept.
+class Spectrogram {
+   public:
+    // Throws std::invalid_argument on a bad window size or hop
+    Spectrogram(int channels, float sample_rate,
+                const SpectrogramOptions& options = {});
+
+    // Transforms the columns completed by the frames of `audio`, which has
+    // the constructor's channel count
+    auto push(ConstAudioView audio) -> void;
+
+    // Transforms the last, zero padded, columns once everything is pushed
+    // (a signal shorter than the window still gets one)
+    auto finish() -> void;
+
+    auto get_columns() const -> size_t { return columns; }
+    auto get_bins() const -> int { return options.window_size / 2 + 1; }
+
+    // dB values of `channel`, get_bins() per column
+    auto get_db(int channel) const -> std::span<const float> {
+        return db[channel];
+    }
+
+    // Writes "spect_ch_{i}.pgm" per channel ("spect_mono.pgm" for mono
+    // signals) into `dir`, returns the written paths
+    auto write_images(const std::filesystem::path& dir) const
+        -> std::vector<std::filesystem::path>;
+
+   private:
+    // Transforms the window at the front of `history`, then drops a hop
+    auto transform_column() -> void;
+
+    int channels;
+    float sample_rate;
+    SpectrogramOptions options;
+
+    std::vector<float> window;
+
+    // Density scaling of the periodogram (as scipy.signal.spectrogram)
+    float scale;
+
+    FFT fft;
+
+    // Planar audio from frame `history_start` on, less than a window between
+    // two push() calls. With a hop longer than the window, the frames up to
+    // history_start are skipped when they arrive.
+    std::vector<std::vector<float>> history;
+    size_t history_start = 0;
+    size_t pushed = 0;
+
+    // The dB values, column after column
+    std::vector<std::vector<float>> db;
+    size_t columns = 0;
+};
+
+// Writes the spectrograms of the audio file `path` next to it
+auto write_file_spectrogram(const std::filesystem::path& path,
+                            const SpectrogramOptions& options)
+    -> std::vector<std::filesystem::path>;
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free single-producer/single-consumer ring buffer.
+// All the storage is allocated in the constructor. push() must only be called
+// from one thread and pop() from one (other) thread.
+template <typename T>
+class SPSCQueue {
+   public:
+    // capacity is rounded up to a power of two
+    explicit SPSCQueue(size_t capacity)
+        : slots(std::bit_ceil(capacity)), mask(slots.size() - 1) {}
+
+    auto try_push(const T& value) -> bool {
+        size_t tail = write_pos.load(std::memory_order_relaxed);
+        if (tail - read_pos.load(std::memory_order_acquire) == slots.size()) {
+            return false;
+        }
+
+        slots[tail & mask] = value;
+        write_pos.store(tail + 1, std::memory_order_release);
+        write_pos.notify_one();
+        return true;
+    }
+
+    auto try_pop(T& value) -> bool {
+        size_t head = read_pos.load(std::memory_order_relaxed);
+        if (head == write_pos.load(std::memory_order_acquire)) return false;
+
+        value = slots[head & mask];
+        read_pos.store(head + 1, std::memory_order_release);
+        read_pos.notify_one();
+        return true;
+    }
+
+    // Blocks while the queue is full
+    auto push(const T& value) -> void {
+        while (!try_push(value)) {
+            size_t head = read_pos.load(std::memory_order_acquire);
+            if (write_pos.load(std::memory_order_relaxed) - head ==
+                slots.size()) {
+                read_pos.wait(head, std::memory_order_acquire);
+            }
+        }
+    }
+
+    // Blocks while the queue is empty
+    auto pop() -> T {
+        T value;
+        while (!try_pop(value)) {
+            size_t tail = write_pos.load(std::memory_order_acquire);
+            if (read_pos.load(std::memory_order_relaxed) == tail) {
+                write_pos.wait(tail, std::memory_order_acquire);
+            }
+        }
+        return value;
+    }
+
+   private:
+    std::vector<T> slots;
+    size_t mask;
+
+    // Kept on separate cache lines so producer and consumer don't false share
+    alignas(64) std::atomic<size_t> write_pos = 0;
+    alignas(64) std::atomic<size_t> read_pos = 0;
+};
@@ -2,6 +2,7 @@
 
 #include <sndfile.h>
 
+#include <numbers>
 #include <string>
 
 enum class PassFilterTypes {
@@ -39,6 +40,23 @@ inline auto to_string(PassFilterTypes f_type) -> std::string {
     }
 }
 
+// tan(pi * cutoff / 2), the prewarped SVF gain, for cutoff in [0, 1].
+// [5/4] Pade approximant of tan on [0, pi/4], above which it is reflected
+// through tan(x) = 1 / tan(pi/2 - x). Branch free with a single division, so it
+// vectorizes and is cheap enough for audio rate modulation.
+// Relative error against the exact tan is below 4e-7 on [0, 0.999]; the tanf()
+// of SVF::process is off by up to 6e-5 there, due to rounding its argument.
+inline auto fast_svf_gain(float cutoff) -> float {
+    bool reflect = cutoff > 0.5f;
+    float x = 0.5f * std::numbers::pi_v<float> *
+              (reflect ? 1.0f - cutoff : cutoff);
+    float x2 = x * x;
+
+    float num = x * (945.0f - 105.0f * x2 + x2 * x2);
+    float den = 945.0f - 420.0f * x2 + 15.0f * x2 * x2;
+    return reflect ? den / num : num / den;
+}
+
 // GOAT:
 // https://www.native-instruments.com/fileadmin/ni_media/downloads/pdf/VAFilterDesign_2.1.0.pdf
 // SMALLER: https://cytomic.com/files/dsp/SvfLinearTrapOptimised2.pdf
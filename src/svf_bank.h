@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <span>
+
+#include "svf.h"
+
+// N independent SVFs (channels, bands or voices) running in lock-step.
+//
+// Same trapezoidal SVF as SVF::process, but the state and the coefficients of
+// the N lanes are stored as arrays (structure of arrays). Every step of
+// process() is a loop over the lanes without branches, which the compiler
+// turns into one SSE (N = 4) or AVX (N = 8) instruction per step.
+//
+// Cutoff and resonance are set per lane and kept until changed, so the
+// coefficients are only recomputed when the parameters move. Modulated filters
+// should update them at block rate: set_target() every lane once per control
+// block (16 to 64 samples), then glide() the coefficients linearly to the
+// targets, one step per process() call.
+template <size_t N>
+class SVFBank {
+   public:
+    static constexpr size_t lanes = N;
+
+    SVFBank() {
+        for (size_t lane = 0; lane < N; ++lane) set_params(lane, 0.5f, 0.0f);
+    }
+
+    // cutoff: 0.0 to 1.0, resonance: 0.0 to 1.0, same as SVF::process
+    auto set_params(size_t lane, float cutoff, float resonance) -> void {
+        gain[lane] = std::tan(std::numbers::pi_v<float> * (cutoff * 0.5f));
+        damping[lane] = 2.0f - (2.0f * resonance);
+        update_denominator(lane);
+    }
+
+    auto set_cutoff(size_t lane, float cutoff) -> void {
+        gain[lane] = std::tan(std::numbers::pi_v<float> * (cutoff * 0.5f));
+        update_denominator(lane);
+    }
+
+    auto set_resonance(size_t lane, float resonance) -> void {
+        damping[lane] = 2.0f - (2.0f * resonance);
+        update_denominator(lane);
+    }
+
+    // Block rate modulation, with the gain approximated by fast_svf_gain().
+    // Takes effect on the next glide().
+    auto set_target(size_t lane, float cutoff, float resonance) -> void {
+        target_gain[lane] = fast_svf_gain(cutoff);
+        target_damping[lane] = 2.0f - (2.0f * resonance);
+    }
+
+    // Moves the coefficients of every lane to their targets over the next
+    // `samples` samples. The first glide after construction or reset(), or one
+    // over 0 samples, jumps to the targets.
+    auto glide(int samples) -> void {
+        if (!primed || samples <= 0) {
+            gain = target_gain;
+            damping = target_damping;
+            for (size_t lane = 0; lane < N; ++lane) update_denominator(lane);
+
+            primed = true;
+            glide_left = 0;
+            return;
+        }
+
+        glide_left = samples;
+        for (size_t lane = 0; lane < N; ++lane) {
+            gain_step[lane] = (target_gain[lane] - gain[lane]) / samples;
+            damping_step[lane] =
+                (target_damping[lane] - damping[lane]) / samples;
+        }
+    }
+
+    // Processes one sample of every lane. `shelving_fact` only matters for
+    // "band_shelving".
+    auto process(std::span<const float, N> input, std::span<float, N> output,
+                 PassFilterTypes filter_type, float shelving_fact = 0)
+        -> void {
+        if (glide_left > 0) glide_step();
+
+        // The response is picked once, outside of the lane loop
+        switch (filter_type) {
+            case PassFilterTypes::high_pass:
+                return tick(input, output,
+                            [](float v0, float v1, float v2, float k) {
+                                return v0 - k * v1 - v2;
+                            });
+            case PassFilterTypes::low_pass:
+                return tick(input, output,
+                            [](float, float, float v2, float) { return v2; });
+            case PassFilterTypes::band_pass:
+                return tick(input, output,
+                            [](float, float v1, float, float) { return v1; });
+            case PassFilterTypes::band_shelving:
+                return tick(input, output,
+                            [=](float v0, float v1, float, float k) {
+                                return v0 + 2.0f * k * shelving_fact * v1;
+                            });
+            case PassFilterTypes::notch_filter:
+                return tick(input, output,
+                            [](float v0, float v1, float, float k) {
+                                return v0 - 2.0f * k * v1;
+                            });
+            case PassFilterTypes::all_pass_filter:
+                return tick(input, output,
+                            [](float v0, float v1, float, float k) {
+                                return v0 - 4.0f * k * v1;
+                            });
+            case PassFilterTypes::peaking_filter:
+                return tick(input, output,
+                            [](float v0, float v1, float v2, float k) {
+                                return std::min(1.0f, v2 - (v0 - k * v1 - v2));
+                            });
+            default:
+                std::fill(output.begin(), output.end(), 0.0f);
+                return;
+        }
+    }
+
+    auto reset() -> void {
+        ic1eq.fill(0.0f);
+        ic2eq.fill(0.0f);
+        primed = false;
+        glide_left = 0;
+    }
+
+   private:
+    auto update_denominator(size_t lane) -> void {
+        inv_denominator[lane] =
+            1.0f / (1.0f + gain[lane] * (gain[lane] + damping[lane]));
+    }
+
+    auto glide_step() -> void {
+        // The last step lands exactly on the targets
+        if (--glide_left == 0) {
+            gain = target_gain;
+            damping = target_damping;
+        } else {
+            for (size_t lane = 0; lane < N; ++lane) {
+                gain[lane] += gain_step[lane];
+                damping[lane] += damping_step[lane];
+            }
+        }
+
+        for (size_t lane = 0; lane < N; ++lane) update_denominator(lane);
+    }
+
+    template <typename Response>
+    auto tick(std::span<const float, N> input, std::span<float, N> output,
+              Response response) -> void {
+        for (size_t lane = 0; lane < N; ++lane) {
+            float v0 = input[lane];
+            float v3 = v0 - ic2eq[lane];
+            float v1 = (gain[lane] * v3 + ic1eq[lane]) * inv_denominator[lane];
+            float v2 = gain[lane] * v1 + ic2eq[lane];
+
+            ic1eq[lane] = 2.0f * v1 - ic1eq[lane];
+            ic2eq[lane] = 2.0f * v2 - ic2eq[lane];
+
+            output[lane] = response(v0, v1, v2, damping[lane]);
+        }
+    }
+
+    // The two integrators of every lane
+    alignas(32) std::array<float, N> ic1eq{}, ic2eq{};
+
+    alignas(32) std::array<float, N> gain{}, damping{}, inv_denominator{};
+
+    alignas(32) std::array<float, N> target_gain{}, target_damping{};
+    alignas(32) std::array<float, N> gain_step{}, damping_step{};
+    int glide_left = 0;
+    bool primed = false;
+};
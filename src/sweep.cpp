@@ -0,0 +1,280 @@
+#include "sweep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <format>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+#include "audio_handler.h"
+#include "batch.h"
+#include "thread_pool.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr size_t FRAMES_COUNT = 4096;
+
+// Planar audio, shared read-only by the tasks depending on it
+struct Signal {
+    AudioBuffer samples;
+    size_t frames = 0;
+
+    auto get_channels() const -> int { return samples.get_channels(); }
+    auto view() const -> ConstAudioView {
+        return samples.view(get_channels(), frames);
+    }
+};
+
+struct SweepContext {
+    std::vector<std::string> chain;
+
+    // Parameter sets of every level (filter) of the chain
+    std::vector<std::vector<FilterParams>> grids;
+
+    const ChainResources& resources;
+    float sample_rate;
+    SF_INFO info;
+    std::string audio_name;
+    fs::path output_root;
+
+    ThreadPool& pool;
+
+    std::mutex results_mutex{};
+    std::vector<SweepResult> results{};
+};
+
+// Every combination of the values swept for `filter`
+auto expand_grid(const std::string& filter,
+                 const std::vector<SweepParam>& params)
+    -> std::vector<FilterParams> {
+    std::vector<FilterParams> grid = {{}};
+
+    for (const auto& param : params) {
+        if (param.filter != filter) continue;
+
+        std::vector<FilterParams> expanded;
+        for (const auto& point : grid) {
+            for (float value : param.values) {
+                expanded.push_back(point);
+                expanded.back()[param.name] = value;
+            }
+        }
+        grid = std::move(expanded);
+    }
+
+    return grid;
+}
+
+auto decode(const fs::path& path, SF_INFO& info) -> Signal {
+    AudioFileHandler fh;
+    if (!fh.open_read(path.string())) {
+        throw std::runtime_error("Failed to open " + path.string());
+    }
+    info = fh.get_info();
+
+    Signal signal;
+    signal.samples.resize(fh.get_channels(), fh.get_total_frames());
+    signal.frames = fh.read_frames(signal.samples.view());
+    return signal;
+}
+
+// Runs `filter` over the whole signal in blocks, like a streaming chain does
+auto render(AMPFilter& filter, const Signal& input) -> Signal {
+    size_t frames = input.frames;
+    Signal output;
+    output.samples.resize(filter.get_out_channels(), frames);
+    output.frames = frames;
+
+    ConstAudioView in = input.view();
+    AudioView out = output.samples.view();
+    for (size_t start = 0; start < frames; start += FRAMES_COUNT) {
+        size_t count = std::min(FRAMES_COUNT, frames - start);
+        filter.process(in.subview(start, count), out.subview(start, count));
+    }
+
+    return output;
+}
+
+auto write(const Signal& signal, const fs::path& path, SF_INFO info) -> void {
+    fs::create_directories(path.parent_path());
+
+    info.channels = signal.get_channels();
+    AudioFileHandler fh;
+    if (!fh.open_write(path.string(), info)) {
+        throw std::runtime_error("Failed to open " + path.string());
+    }
+
+    fh.write_frames(signal.view());
+    if (!fh.close(false)) {
+        throw std::runtime_error("Failed to write " + path.string());
+    }
+}
+
+// "name=value name=value" of a grid point
+auto describe(const FilterParams& params) -> std::string {
+    std::string text;
+    for (const auto& [name, value] : params) {
+        if (!text.empty()) text += ' ';
+        text += std::format("{}={}", name, value);
+    }
+    return text;
+}
+
+// The grid points of a filter are told apart by get_output_dir(), which
+// rounds the values (to 2 decimals for most filters). Two points whose
+// directories are equal would overwrite each other's renders and everything
+// downstream of them, so the sweep is rejected before anything runs.
+// Throws std::invalid_argument naming the two points.
+auto check_output_dirs(const SweepContext& ctx, int channels) -> void {
+    for (size_t level = 0; level < ctx.chain.size(); ++level) {
+        std::map<std::string, const FilterParams*> dirs;
+        int out_channels = channels;
+        for (const auto& params : ctx.grids[level]) {
+            std::unique_ptr<AMPFilter> filter;
+            try {
+                filter = make_filter(ctx.chain[level], channels,
+                                     ctx.sample_rate, ctx.resources, params);
+            } catch (const std::exception&) {
+                // Left to the render, which reports it for this point
+                continue;
+            }
+            out_channels = filter->get_out_channels();
+
+            auto [first, inserted] =
+                dirs.emplace(filter->get_output_dir(ctx.audio_name), &params);
+            if (!inserted) {
+                throw std::invalid_argument(std::format(
+                    "{}: {} and {} both render to {}", ctx.chain[level],
+                    describe(*first->second), describe(params),
+                    first->first));
+            }
+        }
+        channels = out_channels;
+    }
+}
+
+auto add_result(SweepContext& ctx, SweepResult result) -> void {
+    std::lock_guard lock(ctx.results_mutex);
+    ctx.results.push_back(std::move(result));
+}
+
+// Renders chain[level] for each of its parameter sets on top of `input`, the
+// shared output of the chain's prefix
+auto schedule_level(SweepContext& ctx, size_t level,
+                    std::shared_ptr<const Signal> input, fs::path prefix_dir)
+    -> void {
+    for (const auto& params : ctx.grids[level]) {
+        ctx.pool.submit([&ctx, level, input, prefix_dir, params] {
+            fs::path dir;
+            try {
+                auto filter =
+                    make_filter(ctx.chain[level], input->get_channels(),
+                                ctx.sample_rate, ctx.resources, params);
+                dir = filter->get_output_dir(ctx.audio_name);
+
+                auto output =
+                    std::make_shared<const Signal>(render(*filter, *input));
+
+                if (level + 1 < ctx.chain.size()) {
+                    schedule_level(ctx, level + 1, std::move(output),
+                                   prefix_dir / (ctx.chain[level] + "_" +
+                                                 dir.filename().string()));
+                    return;
+                }
+
+                fs::path path = ctx.output_root / dir.parent_path() /
+                                prefix_dir / dir.filename() / "audio.wav";
+                write(*output, path, ctx.info);
+                add_result(ctx, {path, ""});
+            } catch (const std::exception& e) {
+                add_result(ctx, {ctx.output_root / prefix_dir / dir, e.what()});
+            }
+        });
+    }
+}
+}  // namespace
+
+auto parse_sweep_param(const std::string& spec) -> SweepParam {
+    size_t dot = spec.find('.');
+    size_t equals = spec.find('=');
+    if (dot == std::string::npos || equals == std::string::npos ||
+        equals < dot) {
+        throw std::invalid_argument("Malformed sweep parameter: " + spec);
+    }
+
+    SweepParam param;
+    param.filter = spec.substr(0, dot);
+    param.name = spec.substr(dot + 1, equals - dot - 1);
+    std::string values = spec.substr(equals + 1);
+
+    if (values.find(':') != std::string::npos) {
+        float start = 0, stop = 0, step = 0;
+        char sep1 = 0, sep2 = 0;
+        std::stringstream stream(values);
+        stream >> start >> sep1 >> stop >> sep2 >> step;
+        if (!stream || sep1 != ':' || sep2 != ':' || step <= 0) {
+            throw std::invalid_argument("Malformed range: " + values);
+        }
+
+        // Counted up front so float steps don't drop the last value
+        int count = (int)std::floor((stop - start) / step + 1e-4f) + 1;
+        for (int i = 0; i < count; ++i) {
+            param.values.push_back(start + i * step);
+        }
+    } else {
+        std::stringstream stream(values);
+        std::string value;
+        while (std::getline(stream, value, ',')) {
+            param.values.push_back(std::stof(value));
+        }
+    }
+
+    if (param.values.empty()) {
+        throw std::invalid_argument("No values in: " + spec);
+    }
+    return param;
+}
+
+auto run_sweep(const fs::path& input, const fs::path& output_root,
+               const std::vector<std::string>& chain,
+               const std::vector<SweepParam>& params,
+               const ChainResources& resources, size_t thread_count)
+    -> std::vector<SweepResult> {
+    if (chain.empty()) return {};
+
+    for (const auto& param : params) {
+        if (std::ranges::find(chain, param.filter) == chain.end()) {
+            throw std::invalid_argument("Swept filter not in the chain: " +
+                                        param.filter);
+        }
+    }
+
+    ThreadPool pool(thread_count);
+    SweepContext ctx{.chain = chain,
+                     .grids = {},
+                     .resources = resources,
+                     .sample_rate = 0,
+                     .info = {},
+                     .audio_name = get_audio_name(input),
+                     .output_root = output_root,
+                     .pool = pool};
+
+    for (const auto& name : chain) {
+        ctx.grids.push_back(expand_grid(name, params));
+    }
+
+    auto signal = std::make_shared<const Signal>(decode(input, ctx.info));
+    ctx.sample_rate = ctx.info.samplerate;
+    check_output_dirs(ctx, signal->get_channels());
+
+    schedule_level(ctx, 0, std::move(signal), {});
+    pool.wait();
+
+    std::ranges::sort(ctx.results, {}, &SweepResult::output);
+    return std::move(ctx.results);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "filter_chain.h"
+
+// A constructor parameter of one filter of the chain and its swept values
+struct SweepParam {
+    std::string filter;
+    std::string name;
+    std::vector<float> values;
+};
+
+// Parses "{filter}.{name}={values}", values being "start:stop:step" (stop
+// included), a comma separated list or a single value.
+// Throws std::invalid_argument on malformed specs.
+auto parse_sweep_param(const std::string& spec) -> SweepParam;
+
+struct SweepResult {
+    std::filesystem::path output;
+
+    // Empty when the grid point was rendered
+    std::string error;
+};
+
+// Renders `input` through `chain` for every point of the parameter grid.
+//
+// The input is decoded once and shared by every grid point. The grid is
+// rendered as a tree, one level per filter of the chain: the output of a
+// filter for one set of parameters is computed once and reused by all the
+// grid points downstream of it. Nodes run as tasks on a work-stealing pool.
+//
+// Results go to "{output_root}/{get_output_dir(audio_name)}/audio.wav" of the
+// last filter, with a "{filter}_{params}" directory for each upstream filter
+// inserted before the last filter's params directory.
+//
+// Throws std::invalid_argument, before rendering anything, when two values of
+// a filter give the same directory (e.g. 1.001 and 1.004 both print 1.00).
+auto run_sweep(const std::filesystem::path& input,
+               const std::filesystem::path& output_root,
+               const std::vector<std::string>& chain,
+               const std::vector<SweepParam>& params,
+               const ChainResources& resources, size_t thread_count)
+    -> std::vector<SweepResult>;
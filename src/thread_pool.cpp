@@ -0,0 +1,101 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace {
+// The pool and index of the worker running on this thread, if any
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_index = 0;
+}  // namespace
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    thread_count = workers_for(thread_count);
+
+    for (size_t i = 0; i < thread_count; ++i) {
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers.emplace_back(
+            [this, i](std::stop_token stop) { run(stop, i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    for (auto& worker : workers) worker.request_stop();
+    workers.clear();  // joins
+}
+
+auto ThreadPool::submit(std::function<void()> task) -> void {
+    size_t index = current_pool == this
+                       ? current_index
+                       : next_queue.fetch_add(1) % queues.size();
+
+    pending.fetch_add(1);
+
+    // Counted under the state mutex so a worker going to sleep can't miss it
+    {
+        std::lock_guard lock(state_mutex);
+        queued.fetch_add(1);
+    }
+    {
+        std::lock_guard lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    work_available.notify_one();
+}
+
+auto ThreadPool::wait() -> void {
+    std::unique_lock lock(state_mutex);
+    all_done.wait(lock, [this] { return pending.load() == 0; });
+}
+
+auto ThreadPool::try_take(size_t index, std::function<void()>& task) -> bool {
+    // Own tasks, newest first
+    {
+        auto& own = *queues[index];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+
+    // Steal the oldest task of another worker
+    for (size_t offset = 1; offset < queues.size(); ++offset) {
+        auto& victim = *queues[(index + offset) % queues.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+auto ThreadPool::run(std::stop_token stop, size_t index) -> void {
+    current_pool = this;
+    current_index = index;
+
+    while (!stop.stop_requested()) {
+        std::function<void()> task;
+        if (!try_take(index, task)) {
+            std::unique_lock lock(state_mutex);
+            work_available.wait(lock, stop,
+                                [this] { return queued.load() > 0; });
+            continue;
+        }
+
+        task();
+
+        if (pending.fetch_sub(1) == 1) {
+            std::lock_guard lock(state_mutex);
+            all_done.notify_all();
+        }
+    }
+}
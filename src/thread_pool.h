@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool.
+// Every worker owns a task deque: it takes its own tasks from the back and,
+// once that is empty, steals from the front of the other workers' deques.
+// Tasks submitted from a worker go to that worker's deque, the others are
+// distributed round-robin.
+class ThreadPool {
+   public:
+    explicit ThreadPool(
+        size_t thread_count = std::thread::hardware_concurrency());
+    // Finishes every submitted task before joining the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+
+    auto submit(std::function<void()> task) -> void;
+
+    // Blocks until every submitted task has finished
+    auto wait() -> void;
+
+    auto get_thread_count() const -> size_t { return workers.size(); }
+
+    // The number of workers a pool asked for `thread_count` threads runs
+    static auto workers_for(size_t thread_count) -> size_t {
+        return std::max<size_t>(1, thread_count);
+    }
+
+   private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    auto run(std::stop_token stop, size_t index) -> void;
+    auto try_take(size_t index, std::function<void()>& task) -> bool;
+
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::atomic<size_t> next_queue = 0;
+
+    // Tasks waiting in a queue / not finished yet
+    std::atomic<size_t> queued = 0;
+    std::atomic<size_t> pending = 0;
+
+    std::mutex state_mutex;
+    std::condition_variable_any work_available;
+    std::condition_variable all_done;
+
+    std::vector<std::jthread> workers;
+};
@@ -0,0 +1,173 @@
+#include "trace.h"
+
+#include <array>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <print>
+#include <vector>
+
+#if __has_include(<cxxabi.h>)
+#include <cxxabi.h>
+#endif
+
+namespace trace {
+namespace {
+struct Event {
+    const char* name;
+    int64_t begin, end;
+    size_t frames;
+    Category category;
+};
+
+// Events are appended in chunks, so a long render never copies them
+constexpr size_t CHUNK_EVENTS = 4096;
+using Chunk = std::array<Event, CHUNK_EVENTS>;
+
+// Only written by its own thread, read once every thread is done
+struct ThreadBuffer {
+    int id;
+    std::string name;
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    size_t used = CHUNK_EVENTS;
+};
+
+std::mutex threads_mutex;
+std::vector<std::unique_ptr<ThreadBuffer>> threads;
+
+thread_local ThreadBuffer* local = nullptr;
+
+std::string output_path;
+std::chrono::steady_clock::time_point epoch;
+
+auto get_local() -> ThreadBuffer& {
+    if (!local) {
+        std::lock_guard lock(threads_mutex);
+        int id = threads.size() + 1;
+        threads.push_back(std::make_unique<ThreadBuffer>(
+            id, std::format("thread {}", id)));
+        local = threads.back().get();
+    }
+    return *local;
+}
+
+auto category_name(Category category) -> const char* {
+    switch (category) {
+        case Category::filter:
+            return "filter";
+        case Category::io:
+            return "io";
+        case Category::pipeline:
+            return "pipeline";
+    }
+    return "";
+}
+
+auto demangle(const char* name) -> std::string {
+#if __has_include(<cxxabi.h>)
+    int status = 0;
+    char* readable = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    if (status == 0 && readable) {
+        std::string result = readable;
+        std::free(readable);
+        return result;
+    }
+#endif
+    return name;
+}
+
+auto escape(const std::string& text) -> std::string {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+}  // namespace
+
+namespace detail {
+auto now() -> int64_t {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - epoch)
+        .count();
+}
+
+auto record(const char* name, Category category, int64_t begin, int64_t end,
+            size_t frames) -> void {
+    ThreadBuffer& buffer = get_local();
+    if (buffer.used == CHUNK_EVENTS) {
+        buffer.chunks.push_back(std::make_unique<Chunk>());
+        buffer.used = 0;
+    }
+    (*buffer.chunks.back())[buffer.used++] = {name, begin, end, frames,
+                                              category};
+}
+}  // namespace detail
+
+auto start(const std::string& path) -> void {
+    output_path = path;
+    epoch = std::chrono::steady_clock::now();
+
+    static bool registered = false;
+    if (!registered) {
+        std::atexit([] { write(); });
+        registered = true;
+    }
+
+    detail::active = true;
+}
+
+auto set_thread_name(const std::string& name) -> void {
+    if (is_active()) get_local().name = name;
+}
+
+auto write() -> bool {
+    if (!detail::active.exchange(false)) return true;
+
+    std::ofstream file(output_path);
+    if (!file) {
+        std::print("[ERROR]: Failed to write the trace to {}\n", output_path);
+        return false;
+    }
+
+    std::lock_guard lock(threads_mutex);
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    file << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, "
+            "\"args\": {\"name\": \"AudioProcessor\"}}";
+
+    size_t count = 0;
+    for (const auto& thread : threads) {
+        file << std::format(
+            ",\n{{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+            "\"tid\": {}, \"args\": {{\"name\": \"{}\"}}}}",
+            thread->id, escape(thread->name));
+
+        for (size_t c = 0; c < thread->chunks.size(); ++c) {
+            size_t used =
+                c + 1 == thread->chunks.size() ? thread->used : CHUNK_EVENTS;
+            for (size_t e = 0; e < used; ++e) {
+                const Event& event = (*thread->chunks[c])[e];
+                std::string name = event.category == Category::filter
+                                       ? demangle(event.name)
+                                       : event.name;
+                // Chrome traces count in microseconds
+                file << std::format(
+                    ",\n{{\"name\": \"{}\", \"cat\": \"{}\", \"ph\": \"X\", "
+                    "\"pid\": 1, \"tid\": {}, \"ts\": {:.3f}, \"dur\": {:.3f}, "
+                    "\"args\": {{\"frames\": {}}}}}",
+                    escape(name), category_name(event.category), thread->id,
+                    event.begin / 1e3, (event.end - event.begin) / 1e3,
+                    event.frames);
+                count++;
+            }
+        }
+    }
+    file << "\n]}\n";
+
+    std::print("[TRACE]: Wrote {} spans to {}\n", count, output_path);
+    return true;
+}
+}  // namespace trace
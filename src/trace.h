@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <typeinfo>
+
+#include "amp_filter.h"
+
+// Timing spans exported as a Chrome trace (chrome://tracing, ui.perfetto.dev).
+//
+// Every thread appends its spans to its own buffer, so recording takes no
+// lock. The buffers are written out when the program exits. Until start() is
+// called a Span only loads one flag.
+namespace trace {
+enum class Category : uint8_t { filter, io, pipeline };
+
+namespace detail {
+inline std::atomic<bool> active = false;
+
+auto now() -> int64_t;
+
+// `name` must outlive the trace, filter names are demangled when written
+auto record(const char* name, Category category, int64_t begin, int64_t end,
+            size_t frames) -> void;
+}  // namespace detail
+
+// Starts recording, the trace is written to `path` at exit
+auto start(const std::string& path) -> void;
+
+// Writes the trace now. Every other thread must be done recording.
+auto write() -> bool;
+
+// Names the calling thread in the trace
+auto set_thread_name(const std::string& name) -> void;
+
+inline auto is_active() -> bool {
+    return detail::active.load(std::memory_order_relaxed);
+}
+
+// Records the time from construction to destruction
+class Span {
+   public:
+    Span(const char* name, Category category, size_t frames = 0)
+        : name(name), category(category), frames(frames) {
+        if (is_active()) begin = detail::now();
+    }
+
+    // Named after the filter's class
+    Span(AMPFilter& filter, size_t frames)
+        : Span(typeid(filter).name(), Category::filter, frames) {}
+
+    ~Span() {
+        if (begin >= 0) {
+            detail::record(name, category, begin, detail::now(), frames);
+        }
+    }
+
+    Span(const Span&) = delete;
+    auto operator=(const Span&) -> Span& = delete;
+
+   private:
+    const char* name;
+    Category category;
+    size_t frames;
+    int64_t begin = -1;
+};
+}  // namespace trace
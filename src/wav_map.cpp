@@ -0,0 +1,182 @@
+#include "wav_map.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr uint16_t FORMAT_PCM = 1;
+constexpr uint16_t FORMAT_IEEE_FLOAT = 3;
+constexpr uint16_t FORMAT_EXTENSIBLE = 0xFFFE;
+
+auto read_u16(const unsigned char* bytes) -> uint16_t {
+    return bytes[0] | bytes[1] << 8;
+}
+
+auto read_u32(const unsigned char* bytes) -> uint32_t {
+    return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+auto sample_format(uint16_t tag, uint16_t bits)
+    -> std::optional<WavMap::SampleFormat> {
+    if (tag == FORMAT_PCM && bits == 16) return WavMap::SampleFormat::pcm16;
+    if (tag == FORMAT_PCM && bits == 24) return WavMap::SampleFormat::pcm24;
+    if (tag == FORMAT_IEEE_FLOAT && bits == 32) {
+        return WavMap::SampleFormat::float32;
+    }
+    return std::nullopt;
+}
+
+// Plain loops the compiler vectorizes (the 24 bit one needs AVX2, see
+// AMP_NATIVE_ARCH)
+auto convert_pcm16(const unsigned char* in, float* out, size_t count) -> void {
+    for (size_t i = 0; i < count; ++i) {
+        int16_t sample;
+        std::memcpy(&sample, in + i * 2, 2);
+        out[i] = sample * (1.0f / 32768.0f);
+    }
+}
+
+auto convert_pcm24(const unsigned char* in, float* out, size_t count) -> void {
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t bits = (uint32_t)in[3 * i] << 8 |
+                        (uint32_t)in[3 * i + 1] << 16 |
+                        (uint32_t)in[3 * i + 2] << 24;
+        // Sign extended by the arithmetic shift
+        out[i] = (float)((int32_t)bits >> 8) * (1.0f / 8388608.0f);
+    }
+}
+}  // namespace
+
+auto WavMap::open(const std::string& path) -> bool {
+    close();
+
+#ifdef _WIN32
+    return false;
+#else
+    // The samples are used in the file's (little endian) byte order
+    if constexpr (std::endian::native != std::endian::little) return false;
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < 12) {
+        ::close(fd);
+        return false;
+    }
+
+    void* address =
+        mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) return false;
+
+    mapping = static_cast<const unsigned char*>(address);
+    mapping_size = info.st_size;
+
+    if (std::memcmp(mapping, "RIFF", 4) != 0 ||
+        std::memcmp(mapping + 8, "WAVE", 4) != 0) {
+        close();
+        return false;
+    }
+
+    std::optional<SampleFormat> found_format;
+    size_t block_align = 0, data_size = 0;
+
+    size_t pos = 12;
+    while (pos + 8 <= mapping_size) {
+        const unsigned char* chunk = mapping + pos;
+        size_t size = read_u32(chunk + 4);
+        size_t available = mapping_size - pos - 8;
+
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && size >= 16 &&
+            size <= available) {
+            uint16_t tag = read_u16(chunk + 8);
+            channels = read_u16(chunk + 10);
+            sample_rate = read_u32(chunk + 12);
+            block_align = read_u16(chunk + 20);
+            uint16_t bits = read_u16(chunk + 22);
+
+            // The actual format is the first two bytes of the sub format GUID
+            if (tag == FORMAT_EXTENSIBLE && size >= 40) {
+                tag = read_u16(chunk + 32);
+            }
+            found_format = sample_format(tag, bits);
+            if (block_align != channels * bits / 8u) found_format.reset();
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            data = chunk + 8;
+            // Unfinished recordings can claim more than the file holds
+            data_size = std::min(size, available);
+            break;
+        }
+
+        // Chunks are padded to an even size
+        pos += 8 + size + (size & 1);
+    }
+
+    if (!found_format || !data || channels == 0) {
+        close();
+        return false;
+    }
+
+    format = *found_format;
+    total_frames = data_size / block_align;
+
+    // float32 samples are read in place, they have to be aligned
+    if (format == SampleFormat::float32 &&
+        (data - mapping) % alignof(float) != 0) {
+        close();
+        return false;
+    }
+
+    madvise(address, mapping_size, MADV_SEQUENTIAL);
+    return true;
+#endif
+}
+
+auto WavMap::close() -> void {
+#ifndef _WIN32
+    if (mapping) munmap(const_cast<unsigned char*>(mapping), mapping_size);
+#endif
+    mapping = nullptr;
+    mapping_size = 0;
+    data = nullptr;
+    channels = 0;
+    sample_rate = 0;
+    total_frames = 0;
+}
+
+auto WavMap::get_float_samples() const -> std::span<const float> {
+    if (!mapping || format != SampleFormat::float32) return {};
+    return {reinterpret_cast<const float*>(data), total_frames * channels};
+}
+
+auto WavMap::read(size_t first_frame, float* out, size_t frames) const
+    -> size_t {
+    if (first_frame >= total_frames) return 0;
+    frames = std::min(frames, total_frames - first_frame);
+
+    size_t first = first_frame * channels;
+    size_t count = frames * channels;
+    switch (format) {
+        case SampleFormat::float32:
+            std::copy_n(get_float_samples().data() + first, count, out);
+            break;
+        case SampleFormat::pcm16:
+            convert_pcm16(data + first * 2, out, count);
+            break;
+        case SampleFormat::pcm24:
+            convert_pcm24(data + first * 3, out, count);
+            break;
+    }
+    return frames;
+}
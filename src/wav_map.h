@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+
+// Read-only memory mapping of an uncompressed WAV file.
+//
+// Only the header is parsed when opening, the samples are paged in by the OS
+// as they are read, so opening takes the same time whatever the file size.
+// float32 samples are exposed as is, 16 and 24 bit PCM are converted on read.
+// Any other file (or platform) fails to open, and is left to libsndfile.
+class WavMap {
+   public:
+    enum class SampleFormat { pcm16, pcm24, float32 };
+
+    WavMap() = default;
+    ~WavMap() { close(); }
+
+    WavMap(const WavMap&) = delete;
+    auto operator=(const WavMap&) -> WavMap& = delete;
+
+    auto open(const std::string& path) -> bool;
+    auto close() -> void;
+
+    auto is_open() const -> bool { return mapping != nullptr; }
+    auto get_channels() const -> int { return channels; }
+    auto get_sample_rate() const -> int { return sample_rate; }
+    auto get_total_frames() const -> size_t { return total_frames; }
+    auto get_format() const -> SampleFormat { return format; }
+
+    // The interleaved samples of a float32 file, without copy. Empty for the
+    // other formats.
+    auto get_float_samples() const -> std::span<const float>;
+
+    // Converts up to `frames` frames from `first_frame` on into `out`,
+    // returns the amount of frames written
+    auto read(size_t first_frame, float* out, size_t frames) const -> size_t;
+
+   private:
+    const unsigned char* mapping = nullptr;
+    size_t mapping_size = 0;
+
+    // First sample of the data chunk
+    const unsigned char* data = nullptr;
+
+    int channels = 0;
+    int sample_rate = 0;
+    size_t total_frames = 0;
+    SampleFormat format = SampleFormat::float32;
+};